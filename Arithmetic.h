@@ -0,0 +1,918 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BitIO.h"
+#include "BlockFrame.h"
+#include "ByteModel.h"
+
+// 算术编码（静态、自适应、上下文模型）、rANS和区间编码。
+// Arithmetic.cpp的测试程序和命令行工具共用这些函数
+
+
+// --- 共享配置和数据 ---
+const int PRECISION_BITS = 32; // 使用32位精度进行计算
+
+const uint64_t TOP_VALUE = (1ULL << PRECISION_BITS) - 1;
+const uint64_t FIRST_QUARTER = (TOP_VALUE / 4) + 1;
+const uint64_t HALF = (TOP_VALUE / 2) + 1;
+const uint64_t THIRD_QUARTER = FIRST_QUARTER * 3;
+
+// 结束符号放在256个字节值之后，不会与二进制数据中的任何字节冲突
+const int EOF_SYMBOL_CONST = BYTE_SYMBOLS;
+const int MODEL_SYMBOLS = BYTE_SYMBOLS + 1;
+
+// 模型总频率缩放为2^MODEL_TOTAL_BITS：编码时用乘法和移位代替除法，
+// 解码时用累积频率直接查表得到符号。2^15项的查找表为64KB
+const int MODEL_TOTAL_BITS = 15;
+const uint32_t MODEL_TOTAL = 1u << MODEL_TOTAL_BITS;
+
+// 把频率按比例缩放到总和恰好为MODEL_TOTAL，出现过的符号至少为1
+inline std::vector<uint32_t>
+scale_frequencies(const std::vector<uint64_t> &freqs) {
+  uint64_t total = 0;
+  for (uint64_t count : freqs) {
+    total += count;
+  }
+
+  std::vector<uint32_t> scaled(freqs.size(), 0);
+  int64_t scaled_total = 0;
+  for (size_t symbol = 0; symbol < freqs.size(); symbol++) {
+    if (freqs[symbol] == 0)
+      continue;
+    scaled[symbol] = (uint32_t)std::max<uint64_t>(
+        1, (uint64_t)((double)freqs[symbol] * MODEL_TOTAL / total));
+    scaled_total += scaled[symbol];
+  }
+
+  // 取整造成的误差从频率最高的符号开始逐个加减1，直到总和正好。
+  // 没有出现过的符号时没有可调整的频率，返回全0
+  std::vector<int> order;
+  for (size_t symbol = 0; symbol < freqs.size(); symbol++) {
+    if (freqs[symbol] > 0)
+      order.push_back((int)symbol);
+  }
+  if (order.empty())
+    return scaled;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int a, int b) { return freqs[a] > freqs[b]; });
+  for (size_t i = 0; scaled_total != MODEL_TOTAL; i = (i + 1) % order.size()) {
+    uint32_t &freq = scaled[order[i]];
+    if (scaled_total < MODEL_TOTAL) {
+      freq++;
+      scaled_total++;
+    } else if (freq > 1) {
+      freq--;
+      scaled_total--;
+    }
+  }
+  return scaled;
+}
+
+// 静态模型：由整段输入的字节频率构建，编码和解码期间不变。
+// 符号s的区间为[cum_low(s), cum_high(s))，频率为0的符号区间为空。
+// 每个模型对象独立，多个编解码器可以在不同线程中各用各的模型
+class StaticFrequencyModel {
+public:
+  StaticFrequencyModel()
+      : cum_freq(MODEL_SYMBOLS + 1, 0), symbol_lookup(MODEL_TOTAL, 0) {}
+
+  explicit StaticFrequencyModel(const std::vector<uint64_t> &byte_freqs)
+      : StaticFrequencyModel() {
+    build(byte_freqs);
+  }
+
+  void build(const std::vector<uint64_t> &byte_freqs) {
+    std::vector<uint64_t> freqs(byte_freqs);
+    freqs.resize(MODEL_SYMBOLS, 0);
+    freqs[EOF_SYMBOL_CONST]++; // 添加EOF频率
+
+    std::vector<uint32_t> scaled = scale_frequencies(freqs);
+    cum_freq[0] = 0;
+    for (int symbol = 0; symbol < MODEL_SYMBOLS; symbol++) {
+      cum_freq[symbol + 1] = cum_freq[symbol] + scaled[symbol];
+      std::fill(symbol_lookup.begin() + cum_freq[symbol],
+                symbol_lookup.begin() + cum_freq[symbol + 1],
+                (uint16_t)symbol);
+    }
+  }
+
+  uint32_t cum_low(int symbol) const { return cum_freq[symbol]; }
+  uint32_t cum_high(int symbol) const { return cum_freq[symbol + 1]; }
+
+  // 累积频率 -> 符号
+  int find(uint32_t target) const { return symbol_lookup[target]; }
+
+private:
+  std::vector<uint32_t> cum_freq;
+  std::vector<uint16_t> symbol_lookup;
+};
+
+// 把区间缩小到累积频率[cum_low, cum_high)对应的子区间。区间按unit = range / total
+// 为单位划分，最后一个符号取到区间上限，舍去的部分不超过区间的total / range
+inline void narrow_interval(uint64_t &low, uint64_t &high, uint64_t unit,
+                            uint32_t cum_low, uint32_t cum_high,
+                            uint32_t total) {
+  if (cum_high < total)
+    high = low + unit * cum_high - 1;
+  low = low + unit * cum_low;
+}
+
+// --- 编码器 ---
+// 区间状态都在对象内，不同线程可以同时使用各自的编码器
+class ArithmeticEncoder {
+public:
+  // 码流追加到out末尾。out由调用方提供，清空后重复使用可以避免重新分配
+  explicit ArithmeticEncoder(std::vector<uint8_t> &out) : writer(out) {}
+
+  // 编码累积频率区间[cum_low, cum_high)，总频率为total
+  void encode(uint32_t cum_low, uint32_t cum_high, uint32_t total) {
+    narrow_interval(low, high, (high - low + 1) / total, cum_low, cum_high,
+                    total);
+    renormalize();
+  }
+
+  // 总频率为2^total_bits时用移位代替除法
+  void encode_pow2(uint32_t cum_low, uint32_t cum_high, int total_bits) {
+    narrow_interval(low, high, (high - low + 1) >> total_bits, cum_low,
+                    cum_high, 1u << total_bits);
+    renormalize();
+  }
+
+  // 输出确定最终区间所需的比特并补齐到整字节，返回本编码器写出的比特数
+  uint64_t finish() {
+    pending_underflow_bits++;
+    if (low < FIRST_QUARTER) {
+      output_bit_plus_pending(0);
+    } else {
+      output_bit_plus_pending(1);
+    }
+    return writer.flush();
+  }
+
+private:
+  void output_bit_plus_pending(int bit) {
+    writer.writeBit(bit);
+    writer.writeRepeated(!bit, pending_underflow_bits);
+    pending_underflow_bits = 0;
+  }
+
+  void renormalize() {
+    while (true) {
+      if (high < HALF) { // 如果编码器的上限小于一半，可以确定下一个比特为0
+        output_bit_plus_pending(0);
+        low = low * 2;
+        high = high * 2 + 1;
+      } else if (low >= HALF) { // 如果编码器的下限大于等于一半，可以确定下一个比特为1
+        output_bit_plus_pending(1);
+        low = (low - HALF) * 2;
+        high = (high - HALF) * 2 + 1;
+      } else if (low >= FIRST_QUARTER && high < THIRD_QUARTER) {
+        // 下限大于等于四分之一且上限小于四分之三，无法确定下一个比特，需要等待更多比特
+        pending_underflow_bits++;
+        low = (low - FIRST_QUARTER) * 2;
+        high = (high - FIRST_QUARTER) * 2 + 1;
+      } else {
+        break;
+      }
+    }
+  }
+
+  BitWriter writer;
+  uint64_t low = 0;
+  uint64_t high = TOP_VALUE;
+  uint64_t pending_underflow_bits = 0;
+};
+
+// 用静态模型编码，码流追加到out，返回写出的比特数
+inline uint64_t arithmetic_encode(const StaticFrequencyModel &model,
+                                  const char *input_text, size_t length,
+                                  std::vector<uint8_t> &out) {
+  ArithmeticEncoder encoder(out);
+  for (size_t i = 0; i < length; i++) {
+    int symbol = (unsigned char)input_text[i];
+    encoder.encode_pow2(model.cum_low(symbol), model.cum_high(symbol),
+                        MODEL_TOTAL_BITS);
+  }
+  encoder.encode_pow2(model.cum_low(EOF_SYMBOL_CONST),
+                      model.cum_high(EOF_SYMBOL_CONST), MODEL_TOTAL_BITS);
+  return encoder.finish();
+}
+
+inline PackedBits arithmetic_encode(const StaticFrequencyModel &model,
+                                    const std::string &input_text) {
+  PackedBits encoded_bits;
+  encoded_bits.bitCount = arithmetic_encode(model, input_text.data(),
+                                            input_text.size(),
+                                            encoded_bits.bytes);
+  return encoded_bits;
+}
+
+// --- 解码器 ---
+class ArithmeticDecoder {
+public:
+  ArithmeticDecoder(const uint8_t *data, size_t size)
+      : reader(data, size), bit_limit((uint64_t)size * 8 + PRECISION_BITS) {
+    for (int i = 0; i < PRECISION_BITS; ++i) {
+      code_value = (code_value << 1) | reader.readBit();
+    }
+  }
+
+  // 求出当前码值对应的累积频率，之后必须用consume消耗解出符号的区间
+  uint32_t target(uint32_t total) {
+    unit = (high - low + 1) / total;
+    return (uint32_t)std::min<uint64_t>((code_value - low) / unit, total - 1);
+  }
+
+  uint32_t target_pow2(int total_bits) {
+    unit = (high - low + 1) >> total_bits;
+    return (uint32_t)std::min<uint64_t>((code_value - low) / unit,
+                                        (1u << total_bits) - 1);
+  }
+
+  // 镜像编码器，把区间缩小到解出符号的子区间
+  void consume(uint32_t cum_low, uint32_t cum_high, uint32_t total) {
+    narrow_interval(low, high, unit, cum_low, cum_high, total);
+    renormalize();
+  }
+
+  // 解码器每移出一位才读入一位，与编码器写出的比特一一对应，
+  // 正确的码流读取的比特数不超过码流长度加上开头装入的PRECISION_BITS位。
+  // 超过后读到的都是补上的0，说明码流已损坏
+  bool exhausted() const { return reader.position() > bit_limit; }
+
+private:
+  void renormalize() {
+    while (true) {
+      if (high < HALF) {
+        low = low * 2;
+        high = high * 2 + 1;
+        code_value = code_value * 2 + reader.readBit();
+      } else if (low >= HALF) {
+        low = (low - HALF) * 2;
+        high = (high - HALF) * 2 + 1;
+        code_value = (code_value - HALF) * 2 + reader.readBit();
+      } else if (low >= FIRST_QUARTER && high < THIRD_QUARTER) {
+        low = (low - FIRST_QUARTER) * 2;
+        high = (high - FIRST_QUARTER) * 2 + 1;
+        code_value = (code_value - FIRST_QUARTER) * 2 + reader.readBit();
+      } else {
+        break;
+      }
+    }
+  }
+
+  BitReader reader; // 读到末尾之后返回0
+  uint64_t bit_limit;
+  uint64_t low = 0;
+  uint64_t high = TOP_VALUE;
+  uint64_t code_value = 0; // 从输入比特流派生出的值
+  uint64_t unit = 1;       // 最近一次target求出的区间单位
+};
+
+// 解码到EOF符号为止。解出的字节超过max_length，或码流读完仍没有EOF时
+// 返回false，损坏的码流不会无限地解下去
+inline bool arithmetic_decode(const StaticFrequencyModel &model,
+                              const uint8_t *data, size_t size,
+                              size_t max_length, std::string &decoded_text) {
+  ArithmeticDecoder decoder(data, size);
+  decoded_text.clear();
+  while (true) {
+    // 累积频率直接查表得到符号，每个符号只需一次除法
+    int current_decoded_symbol =
+        model.find(decoder.target_pow2(MODEL_TOTAL_BITS));
+    if (current_decoded_symbol == EOF_SYMBOL_CONST)
+      return true;
+    if (decoded_text.size() == max_length || decoder.exhausted())
+      return false;
+
+    decoder.consume(model.cum_low(current_decoded_symbol),
+                    model.cum_high(current_decoded_symbol), MODEL_TOTAL);
+    decoded_text += (char)current_decoded_symbol;
+  }
+}
+
+// 解码失败时返回空串
+inline std::string arithmetic_decode(const StaticFrequencyModel &model,
+                                     const PackedBits &encoded_bits) {
+  std::string decoded_text;
+  if (!arithmetic_decode(model, encoded_bits.bytes.data(),
+                         encoded_bits.bytes.size(), SIZE_MAX, decoded_text))
+    decoded_text.clear();
+  return decoded_text;
+}
+
+// --- 自适应模型 ---
+// 所有符号的频率从1开始，每编码一个符号就增加它的频率，编码端和解码端
+// 按相同的顺序更新模型，因此不需要传输频率表，输入也只需读一遍。
+// 累积频率保存在树状数组(Fenwick树)中，查询和更新都是O(log n)
+const uint32_t ADAPTIVE_INCREMENT = 32;
+const uint32_t ADAPTIVE_MAX_TOTAL = 1u << 16; // 超过后所有频率减半
+
+class AdaptiveFrequencyModel {
+public:
+  AdaptiveFrequencyModel() : freqs(MODEL_SYMBOLS, 1) { rebuild(); }
+
+  // 以给定的初始频率开始，频率为0的符号在更新之前不占区间
+  explicit AdaptiveFrequencyModel(const std::vector<uint32_t> &initial_freqs)
+      : freqs(initial_freqs) {
+    rebuild();
+  }
+
+  // 清空为只有symbol一个符号（频率为1），沿用已分配的内存。
+  // 只需清零两个数组再做一次树状数组更新，比rebuild快得多
+  void reset_single(int symbol) {
+    std::fill(freqs.begin(), freqs.end(), 0);
+    std::fill(tree.begin(), tree.end(), 0);
+    freqs[symbol] = 1;
+    total_freq = 1;
+    for (int i = symbol + 1; i <= MODEL_SYMBOLS; i += i & -i)
+      tree[i] += 1;
+  }
+
+  uint32_t total() const { return total_freq; }
+
+  uint32_t frequency(int symbol) const { return freqs[symbol]; }
+
+  // 符号的累积频率区间[cum_low, cum_high)
+  void interval(int symbol, uint32_t &cum_low, uint32_t &cum_high) const {
+    cum_low = 0;
+    for (int i = symbol; i > 0; i -= i & -i)
+      cum_low += tree[i];
+    cum_high = cum_low + freqs[symbol];
+  }
+
+  // 找到累积区间包含target的符号：在树上从高位到低位逐步确定下标
+  int find(uint32_t target, uint32_t &cum_low, uint32_t &cum_high) const {
+    int pos = 0;
+    cum_low = 0;
+    for (int step = TOP_STEP; step > 0; step >>= 1) {
+      if (pos + step <= MODEL_SYMBOLS && cum_low + tree[pos + step] <= target) {
+        pos += step;
+        cum_low += tree[pos];
+      }
+    }
+    cum_high = cum_low + freqs[pos];
+    return pos;
+  }
+
+  void update(int symbol) {
+    freqs[symbol] += ADAPTIVE_INCREMENT;
+    total_freq += ADAPTIVE_INCREMENT;
+    if (total_freq > ADAPTIVE_MAX_TOTAL) {
+      // 频率减半，既保证总和不溢出，也让模型更偏向最近的数据
+      for (uint32_t &freq : freqs)
+        freq = (freq + 1) / 2;
+      rebuild();
+      return;
+    }
+    for (int i = symbol + 1; i <= MODEL_SYMBOLS; i += i & -i)
+      tree[i] += ADAPTIVE_INCREMENT;
+  }
+
+private:
+  // 不超过符号数的最大2的幂，查找时的第一步
+  static const int TOP_STEP = 256;
+
+  // 由freqs重建树状数组，tree[i]保存freqs[i - lowbit(i), i)之和
+  void rebuild() {
+    tree.assign(MODEL_SYMBOLS + 1, 0);
+    total_freq = 0;
+    for (int i = 1; i <= MODEL_SYMBOLS; i++) {
+      tree[i] += freqs[i - 1];
+      total_freq += freqs[i - 1];
+      int parent = i + (i & -i);
+      if (parent <= MODEL_SYMBOLS)
+        tree[parent] += tree[i];
+    }
+  }
+
+  std::vector<uint32_t> freqs;
+  std::vector<uint32_t> tree;
+  uint32_t total_freq = 0;
+};
+
+// 用模型的当前频率编码一个符号，不更新模型
+inline void encode_model_symbol(ArithmeticEncoder &encoder,
+                                const AdaptiveFrequencyModel &model,
+                                int symbol) {
+  uint32_t cum_low, cum_high;
+  model.interval(symbol, cum_low, cum_high);
+  encoder.encode(cum_low, cum_high, model.total());
+}
+
+inline int decode_model_symbol(ArithmeticDecoder &decoder,
+                               const AdaptiveFrequencyModel &model) {
+  uint32_t cum_low, cum_high;
+  int symbol = model.find(decoder.target(model.total()), cum_low, cum_high);
+  decoder.consume(cum_low, cum_high, model.total());
+  return symbol;
+}
+
+// 自适应编码：不需要预先统计频率，码流中没有频率表。
+// 码流追加到out，返回写出的比特数
+inline uint64_t arithmetic_encode_adaptive(const char *input_text,
+                                           size_t length,
+                                           std::vector<uint8_t> &out) {
+  ArithmeticEncoder encoder(out);
+  AdaptiveFrequencyModel model;
+
+  for (size_t i = 0; i < length; i++) {
+    int symbol = (unsigned char)input_text[i];
+    encode_model_symbol(encoder, model, symbol);
+    model.update(symbol);
+  }
+  encode_model_symbol(encoder, model, EOF_SYMBOL_CONST);
+  return encoder.finish();
+}
+
+// 与arithmetic_decode一样，超过max_length或码流读完仍没有EOF时返回false
+inline bool arithmetic_decode_adaptive(const uint8_t *data, size_t size,
+                                       size_t max_length,
+                                       std::string &decoded_text) {
+  ArithmeticDecoder decoder(data, size);
+  AdaptiveFrequencyModel model;
+
+  decoded_text.clear();
+  while (true) {
+    int current_decoded_symbol = decode_model_symbol(decoder, model);
+    if (current_decoded_symbol == EOF_SYMBOL_CONST)
+      return true;
+    if (decoded_text.size() == max_length || decoder.exhausted())
+      return false;
+    decoded_text += (char)current_decoded_symbol;
+    model.update(current_decoded_symbol);
+  }
+}
+
+// --- 上下文模型 ---
+// 按前两个字节(二阶)和前一个字节(一阶)选择模型，PPM式逐级退出：
+// 符号在二阶上下文中出现过就在二阶模型中编码，否则编码退出符号后到一阶模型，
+// 仍未出现则再退出到零阶自适应模型（包含所有字节和EOF）。
+// 上下文模型中下标EOF_SYMBOL_CONST的位置用作退出符号，EOF总是退出到零阶编码。
+// 二阶上下文按哈希存放在固定数量的槽中，槽数由内存上限决定，冲突时清空旧模型
+const int CONTEXT_ESCAPE = EOF_SYMBOL_CONST;
+
+struct ContextModelOptions {
+  size_t memory_limit = (size_t)16 << 20; // 二阶上下文表最多占用的字节数
+};
+
+class ContextModel {
+public:
+  explicit ContextModel(const ContextModelOptions &options = {})
+      : escape_only(MODEL_SYMBOLS, 0), order1(BYTE_SYMBOLS) {
+    escape_only[CONTEXT_ESCAPE] = 1;
+    // 每个上下文模型约为频率数组和树状数组两份257项的uint32
+    const size_t model_bytes = sizeof(ContextSlot) +
+                               sizeof(AdaptiveFrequencyModel) +
+                               (2 * MODEL_SYMBOLS + 1) * sizeof(uint32_t);
+    size_t slots = 1;
+    while (slots * 2 * model_bytes <= options.memory_limit)
+      slots *= 2;
+    order2.resize(slots);
+  }
+
+  // 编码一个字节或EOF，并按已编码的字节更新上下文
+  void encode(ArithmeticEncoder &encoder, int symbol) {
+    AdaptiveFrequencyModel *models[2] = {&order2_model(), &order1_model()};
+    int coded_at = 2; // 在哪一级编码：0为二阶，1为一阶，2为零阶
+    for (int level = 0; level < 2; level++) {
+      if (symbol != EOF_SYMBOL_CONST && models[level]->frequency(symbol) > 0) {
+        encode_model_symbol(encoder, *models[level], symbol);
+        coded_at = level;
+        break;
+      }
+      encode_model_symbol(encoder, *models[level], CONTEXT_ESCAPE);
+    }
+    if (coded_at == 2)
+      encode_model_symbol(encoder, order0, symbol);
+    if (symbol != EOF_SYMBOL_CONST)
+      update(models, coded_at, symbol);
+  }
+
+  int decode(ArithmeticDecoder &decoder) {
+    AdaptiveFrequencyModel *models[2] = {&order2_model(), &order1_model()};
+    int symbol = CONTEXT_ESCAPE;
+    int coded_at = 2;
+    for (int level = 0; level < 2; level++) {
+      symbol = decode_model_symbol(decoder, *models[level]);
+      if (symbol != CONTEXT_ESCAPE) {
+        coded_at = level;
+        break;
+      }
+    }
+    if (coded_at == 2)
+      symbol = decode_model_symbol(decoder, order0);
+    if (symbol != EOF_SYMBOL_CONST)
+      update(models, coded_at, symbol);
+    return symbol;
+  }
+
+private:
+  struct ContextSlot {
+    uint32_t key = 0; // 前两个字节 + 1，0表示空槽
+    std::unique_ptr<AdaptiveFrequencyModel> model;
+  };
+
+  // 新建的上下文模型只有退出符号
+  std::unique_ptr<AdaptiveFrequencyModel> new_context_model() const {
+    return std::unique_ptr<AdaptiveFrequencyModel>(
+        new AdaptiveFrequencyModel(escape_only));
+  }
+
+  AdaptiveFrequencyModel &order1_model() {
+    std::unique_ptr<AdaptiveFrequencyModel> &model = order1[history & 0xFF];
+    if (!model)
+      model = new_context_model();
+    return *model;
+  }
+
+  AdaptiveFrequencyModel &order2_model() {
+    uint32_t key = (history & 0xFFFF) + 1;
+    ContextSlot &slot = order2[(key * 2654435761u >> 16) & (order2.size() - 1)];
+    if (!slot.model) {
+      slot.model = new_context_model();
+    } else if (slot.key != key) {
+      slot.model->reset_single(CONTEXT_ESCAPE); // 哈希冲突：旧上下文的统计作废
+    }
+    slot.key = key;
+    return *slot.model;
+  }
+
+  // 编码所在级别的模型增加该符号的频率，退出过的高阶模型加入该符号并增加退出频率
+  void update(AdaptiveFrequencyModel *models[2], int coded_at, int symbol) {
+    for (int level = 0; level < coded_at && level < 2; level++) {
+      models[level]->update(symbol);
+      models[level]->update(CONTEXT_ESCAPE);
+    }
+    if (coded_at < 2)
+      models[coded_at]->update(symbol);
+    else
+      order0.update(symbol);
+    history = (history << 8) | (uint32_t)symbol;
+  }
+
+  std::vector<uint32_t> escape_only; // 新上下文的初始频率
+  AdaptiveFrequencyModel order0;
+  std::vector<std::unique_ptr<AdaptiveFrequencyModel>> order1;
+  std::vector<ContextSlot> order2;
+  uint32_t history = 0; // 最近编码的字节，最低8位为前一个字节
+};
+
+// 码流追加到out，返回写出的比特数
+inline uint64_t
+arithmetic_encode_context(const char *input_text, size_t length,
+                          std::vector<uint8_t> &out,
+                          const ContextModelOptions &options = {}) {
+  ArithmeticEncoder encoder(out);
+  ContextModel model(options);
+  for (size_t i = 0; i < length; i++) {
+    model.encode(encoder, (unsigned char)input_text[i]);
+  }
+  model.encode(encoder, EOF_SYMBOL_CONST);
+  return encoder.finish();
+}
+
+// 超过max_length或码流读完仍没有EOF时返回false
+inline bool
+arithmetic_decode_context(const uint8_t *data, size_t size, size_t max_length,
+                          std::string &decoded_text,
+                          const ContextModelOptions &options = {}) {
+  ArithmeticDecoder decoder(data, size);
+  ContextModel model(options);
+  decoded_text.clear();
+  while (true) {
+    int current_decoded_symbol = model.decode(decoder);
+    if (current_decoded_symbol == EOF_SYMBOL_CONST)
+      return true;
+    if (decoded_text.size() == max_length || decoder.exhausted())
+      return false;
+    decoded_text += (char)current_decoded_symbol;
+  }
+}
+
+// 分块压缩：频率表 + 算术编码码流，码流以EOF符号结束
+inline void arithmetic_encode_block(const char *data, size_t size,
+                                    std::vector<uint8_t> &out) {
+  std::vector<uint64_t> freqs(BYTE_SYMBOLS, 0);
+  countByteFrequencies((const uint8_t *)data, size, freqs.data());
+  StaticFrequencyModel model(freqs);
+  appendFrequencyHeader(out, freqs);
+  arithmetic_encode(model, data, size, out);
+}
+
+inline bool arithmetic_decode_block(const uint8_t *data, size_t size, char *out,
+                                    size_t original_size) {
+  std::vector<uint64_t> freqs;
+  size_t pos = 0;
+  if (!readFrequencyHeader(data, size, pos, freqs, original_size))
+    return false;
+  StaticFrequencyModel model(freqs);
+  std::string decoded_text;
+  if (!arithmetic_decode(model, data + pos, size - pos, original_size,
+                         decoded_text) ||
+      decoded_text.size() != original_size)
+    return false;
+  std::copy(decoded_text.begin(), decoded_text.end(), out);
+  return true;
+}
+
+// 自适应分块压缩：块内只有码流
+inline void encode_adaptive_block(const char *data, size_t size,
+                                  std::vector<uint8_t> &out) {
+  arithmetic_encode_adaptive(data, size, out);
+}
+
+inline bool decode_adaptive_block(const uint8_t *data, size_t size, char *out,
+                                  size_t original_size) {
+  std::string decoded_text;
+  if (!arithmetic_decode_adaptive(data, size, original_size, decoded_text) ||
+      decoded_text.size() != original_size)
+    return false;
+  std::copy(decoded_text.begin(), decoded_text.end(), out);
+  return true;
+}
+
+// 只含256个字节值的静态模型（没有EOF），频率同样缩放到2^MODEL_TOTAL_BITS，
+// 由rANS和区间编码器共用
+struct ByteFrequencyModel {
+  uint32_t freq[BYTE_SYMBOLS];
+  uint32_t cum[BYTE_SYMBOLS + 1];
+  std::vector<uint8_t> lookup; // 累积频率 -> 字节
+};
+
+// 由原始字节频率构建模型，编码端和解码端由同一频率表得到相同的模型
+inline void build_byte_model(const std::vector<uint64_t> &byte_freqs,
+                             ByteFrequencyModel &model) {
+  std::vector<uint32_t> scaled = scale_frequencies(byte_freqs);
+  model.lookup.resize(MODEL_TOTAL);
+  model.cum[0] = 0;
+  for (int symbol = 0; symbol < BYTE_SYMBOLS; symbol++) {
+    model.freq[symbol] = scaled[symbol];
+    model.cum[symbol + 1] = model.cum[symbol] + scaled[symbol];
+    std::fill(model.lookup.begin() + model.cum[symbol],
+              model.lookup.begin() + model.cum[symbol + 1], (uint8_t)symbol);
+  }
+}
+
+// --- rANS ---
+// 静态模型与上面的算术编码相同（频率缩放到2^MODEL_TOTAL_BITS），但用rANS编码：
+// 32位状态，状态低于2^16时按16位字重新归一化，不需要逐比特输出和下溢处理。
+// RANS_STATES个状态交错编码相邻的符号，解码时各状态之间没有数据依赖，
+// CPU可以同时执行几个状态的查表和乘法。
+// 块格式：频率表 + RANS_STATES个4字节小端序的最终状态 + 16位小端序字流
+const int RANS_STATES = 4;
+const uint32_t RANS_LOW = 1u << 16; // 状态的下界
+
+inline void rans_encode_block(const char *data, size_t size,
+                              std::vector<uint8_t> &out) {
+  std::vector<uint64_t> freqs(BYTE_SYMBOLS, 0);
+  countByteFrequencies((const uint8_t *)data, size, freqs.data());
+  appendFrequencyHeader(out, freqs);
+  if (size == 0)
+    return;
+  ByteFrequencyModel model;
+  build_byte_model(freqs, model);
+
+  // 从最后一个符号开始倒序编码，输出的字也是倒序的，最后再整体反转，
+  // 解码端就可以从前往后读。第i个符号使用第i % RANS_STATES个状态
+  uint32_t states[RANS_STATES];
+  std::fill(states, states + RANS_STATES, RANS_LOW);
+  std::vector<uint16_t> words;
+  words.reserve(size / 2 + 16);
+  for (size_t i = size; i-- > 0;) {
+    uint32_t &x = states[i % RANS_STATES];
+    int symbol = (unsigned char)data[i];
+    uint32_t freq = model.freq[symbol];
+    // 保证编码后状态不超过32位。一个符号占满总频率时freq为2^15，
+    // 移位后是2^32，必须用64位比较，否则为0而每个符号都会输出一个字
+    if (x >= ((uint64_t)freq << (32 - MODEL_TOTAL_BITS))) {
+      words.push_back((uint16_t)x);
+      x >>= 16;
+    }
+    x = ((x / freq) << MODEL_TOTAL_BITS) + (x % freq) + model.cum[symbol];
+  }
+
+  size_t pos = out.size();
+  out.resize(pos + 4 * RANS_STATES + 2 * words.size());
+  for (int j = 0; j < RANS_STATES; j++)
+    putLE32(out, pos + 4 * j, states[j]);
+  pos += 4 * RANS_STATES;
+  for (size_t k = words.size(); k-- > 0;) {
+    out[pos++] = (uint8_t)words[k];
+    out[pos++] = (uint8_t)(words[k] >> 8);
+  }
+}
+
+inline bool rans_decode_block(const uint8_t *data, size_t size, char *out,
+                              size_t original_size) {
+  std::vector<uint64_t> freqs;
+  size_t pos = 0;
+  if (!readFrequencyHeader(data, size, pos, freqs, original_size))
+    return false;
+  if (original_size == 0)
+    return true;
+  if (size - pos < 4 * RANS_STATES)
+    return false;
+  ByteFrequencyModel model;
+  build_byte_model(freqs, model);
+
+  uint32_t states[RANS_STATES];
+  for (int j = 0; j < RANS_STATES; j++)
+    states[j] = getLE32(data + pos + 4 * j);
+  const uint8_t *words = data + pos + 4 * RANS_STATES;
+  const uint8_t *words_end = data + size;
+
+  const uint32_t mask = MODEL_TOTAL - 1;
+  auto decode_step = [&](uint32_t &x, size_t i) {
+    uint32_t slot = x & mask;
+    uint8_t symbol = model.lookup[slot];
+    out[i] = (char)symbol;
+    x = model.freq[symbol] * (x >> MODEL_TOTAL_BITS) + slot - model.cum[symbol];
+  };
+  auto refill = [&](uint32_t &x) {
+    if (x < RANS_LOW) {
+      x = (x << 16) | words[0] | ((uint32_t)words[1] << 8);
+      words += 2;
+    }
+  };
+
+  // 快速路径：每轮解码RANS_STATES个相邻的符号，各状态互不依赖；
+  // 剩余的字足够本轮最多读取的数量时才进入，循环内不检查越界
+  size_t i = 0;
+  for (; i + RANS_STATES <= original_size &&
+         words_end - words >= 2 * RANS_STATES;
+       i += RANS_STATES) {
+    for (int j = 0; j < RANS_STATES; j++)
+      decode_step(states[j], i + j);
+    for (int j = 0; j < RANS_STATES; j++)
+      refill(states[j]);
+  }
+  for (; i < original_size; i++) {
+    uint32_t &x = states[i % RANS_STATES];
+    decode_step(x, i);
+    if (x < RANS_LOW && words + 2 > words_end)
+      return false;
+    refill(x);
+  }
+
+  // 正确的码流解码完后所有字都已读完，各状态回到初始值
+  if (words != words_end)
+    return false;
+  for (int j = 0; j < RANS_STATES; j++) {
+    if (states[j] != RANS_LOW)
+      return false;
+  }
+  return true;
+}
+
+// --- 区间编码 ---
+// 字节输出的区间编码器（LZMA式）：low为64位，其中低32位是当前区间下限，
+// 第33位保存进位；range为32位，低于2^24时一次移出一个字节。
+// 最高字节可能因为后面的进位而改变，先存在cache中，连续的0xFF只记个数，
+// 确定没有进位后再一起写出，因此不需要逐比特输出和下溢计数。
+// 码流格式：原始长度(变长整数) + 频率表 + 编码字节，长度已知所以不需要EOF符号
+const uint32_t RANGE_TOP = 1u << 24;
+
+class RangeEncoder {
+public:
+  // 码流追加到out末尾，out由调用方提供
+  explicit RangeEncoder(std::vector<uint8_t> &out) : out(out) {}
+
+  // 编码累积频率区间[cum_low, cum_low + freq)，总频率为2^total_bits
+  void encode_pow2(uint32_t cum_low, uint32_t freq, int total_bits) {
+    uint32_t unit = range >> total_bits;
+    low += (uint64_t)unit * cum_low;
+    range = unit * freq;
+    while (range < RANGE_TOP) {
+      range <<= 8;
+      shift_low();
+    }
+  }
+
+  // 写出low中剩余的字节
+  void finish() {
+    for (int i = 0; i < 5; i++)
+      shift_low();
+  }
+
+private:
+  // 移出low的最高字节。没有进位且该字节为0xFF时还不能确定，先累计个数
+  void shift_low() {
+    if ((uint32_t)low < 0xFF000000u || (low >> 32) != 0) {
+      uint8_t carry = (uint8_t)(low >> 32);
+      uint8_t byte = cache;
+      do {
+        out.push_back((uint8_t)(byte + carry));
+        byte = 0xFF;
+      } while (--cache_size != 0);
+      cache = (uint8_t)(low >> 24);
+    }
+    cache_size++;
+    low = (low & 0x00FFFFFFu) << 8;
+  }
+
+  std::vector<uint8_t> &out;
+  uint64_t low = 0;
+  uint32_t range = 0xFFFFFFFFu;
+  uint8_t cache = 0;       // 尚未写出的最高字节
+  uint64_t cache_size = 1; // cache加上其后待定的0xFF字节数
+};
+
+class RangeDecoder {
+public:
+  // 第一个字节是编码器的初始cache（总为0），连同后4个字节装入code
+  RangeDecoder(const uint8_t *data, size_t size) : data(data), size(size) {
+    for (int i = 0; i < 5; i++)
+      code = (code << 8) | next_byte();
+  }
+
+  // 求出当前码值对应的累积频率，之后必须用consume消耗解出符号的区间
+  uint32_t target_pow2(int total_bits) {
+    unit = range >> total_bits;
+    return std::min(code / unit, (1u << total_bits) - 1);
+  }
+
+  void consume(uint32_t cum_low, uint32_t freq) {
+    code -= unit * cum_low;
+    range = unit * freq;
+    while (range < RANGE_TOP) {
+      range <<= 8;
+      code = (code << 8) | next_byte();
+    }
+  }
+
+private:
+  uint8_t next_byte() { return pos < size ? data[pos++] : 0; }
+
+  const uint8_t *data;
+  size_t size;
+  size_t pos = 0;
+  uint32_t code = 0; // 码值与区间下限之差
+  uint32_t range = 0xFFFFFFFFu;
+  uint32_t unit = 1; // 最近一次target求出的区间单位
+};
+
+inline void range_encode_block(const char *data, size_t size,
+                               std::vector<uint8_t> &out) {
+  std::vector<uint64_t> freqs(BYTE_SYMBOLS, 0);
+  countByteFrequencies((const uint8_t *)data, size, freqs.data());
+  appendVarint(out, size);
+  appendFrequencyHeader(out, freqs);
+  if (size == 0)
+    return;
+  ByteFrequencyModel model;
+  build_byte_model(freqs, model);
+
+  RangeEncoder encoder(out);
+  for (size_t i = 0; i < size; i++) {
+    int symbol = (unsigned char)data[i];
+    encoder.encode_pow2(model.cum[symbol], model.freq[symbol],
+                        MODEL_TOTAL_BITS);
+  }
+  encoder.finish();
+}
+
+inline bool range_decode_block(const uint8_t *data, size_t size, char *out,
+                               size_t original_size) {
+  uint64_t length;
+  std::vector<uint64_t> freqs;
+  size_t pos = 0;
+  if (!readVarint(data, size, pos, length) || length != original_size ||
+      !readFrequencyHeader(data, size, pos, freqs, length))
+    return false;
+  if (length == 0)
+    return true;
+  ByteFrequencyModel model;
+  build_byte_model(freqs, model);
+
+  RangeDecoder decoder(data + pos, size - pos);
+  for (size_t i = 0; i < length; i++) {
+    uint8_t symbol = model.lookup[decoder.target_pow2(MODEL_TOTAL_BITS)];
+    decoder.consume(model.cum[symbol], model.freq[symbol]);
+    out[i] = (char)symbol;
+  }
+  return true;
+}
+
+// 上下文模型分块压缩：块内只有码流，每块从空模型开始
+inline void encode_context_block(const char *data, size_t size,
+                                 std::vector<uint8_t> &out) {
+  arithmetic_encode_context(data, size, out);
+}
+
+inline bool decode_context_block(const uint8_t *data, size_t size, char *out,
+                                 size_t original_size) {
+  std::string decoded_text;
+  if (!arithmetic_decode_context(data, size, original_size, decoded_text) ||
+      decoded_text.size() != original_size)
+    return false;
+  std::copy(decoded_text.begin(), decoded_text.end(), out);
+  return true;
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Arithmetic.h"
+#include "BlockFrame.h"
+#include "ByteModel.h"
+#include "Huffman.h"
+
+// 块排序变换：BWT + MTF + 零游程编码，输出仍是字节流，交给已有的零阶熵编码器。
+//   BWT：把上下文相同的字节排到一起，后缀数组用SA-IS在线性时间内构造
+//   MTF：把局部重复的字节变成很多小值，尤其是大量的0
+//   零游程：0的游程长度用RUNA/RUNB两个符号按双射二进制写出（与bzip2相同）
+// 变换需要整块数据，按块独立进行，因此可以与分块压缩的多线程组合
+
+// --- SA-IS ---
+// s[0, n)的最后一个字符必须是唯一且最小的哨兵0，字母表为[0, k)。
+// Text可以是int指针，也可以是按下标返回字符的对象（见SentinelText）。
+// 结果写入sa[0, n)。递归时把缩减后的子串和它的后缀数组都放在sa中，
+// 除类型标记和桶之外不需要额外内存
+class SuffixArrayBuilder {
+public:
+  template <typename Text> void build(const Text &s, int *sa, int n, int k) {
+    std::vector<bool> stype(n);
+    stype[n - 1] = true;
+    for (int i = n - 2; i >= 0; i--) {
+      stype[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && stype[i + 1]);
+    }
+    auto isLMS = [&](int i) { return i > 0 && stype[i] && !stype[i - 1]; };
+    std::vector<int> bucket(k);
+
+    // 1. LMS位置放到各自桶尾，诱导排序得到排好序的LMS子串
+    std::fill(sa, sa + n, -1);
+    bucketEnds(s, n, k, bucket);
+    for (int i = 1; i < n; i++) {
+      if (isLMS(i))
+        sa[--bucket[s[i]]] = i;
+    }
+    induce(s, sa, n, k, stype, bucket);
+
+    // 2. 给LMS子串命名，名字都不同时直接得到顺序，否则递归排序
+    int n1 = 0;
+    for (int i = 0; i < n; i++) {
+      if (isLMS(sa[i]))
+        sa[n1++] = sa[i];
+    }
+    std::fill(sa + n1, sa + n, -1);
+    int names = 0, previous = -1;
+    for (int i = 0; i < n1; i++) {
+      int pos = sa[i];
+      bool differ = previous < 0;
+      for (int d = 0; !differ; d++) {
+        if (s[pos + d] != s[previous + d] ||
+            stype[pos + d] != stype[previous + d]) {
+          differ = true;
+        } else if (d > 0 && (isLMS(pos + d) || isLMS(previous + d))) {
+          break;
+        }
+      }
+      if (differ) {
+        names++;
+        previous = pos;
+      }
+      sa[n1 + pos / 2] = names - 1; // 相邻LMS位置至少相距2，不会冲突
+    }
+    for (int i = n - 1, j = n - 1; i >= n1; i--) {
+      if (sa[i] >= 0)
+        sa[j--] = sa[i];
+    }
+
+    int *s1 = sa + n - n1;
+    if (names < n1) {
+      build((const int *)s1, sa, n1, names);
+    } else {
+      for (int i = 0; i < n1; i++)
+        sa[s1[i]] = i;
+    }
+
+    // 3. 按LMS后缀的顺序放回桶尾，再诱导出全部后缀
+    for (int i = 1, j = 0; i < n; i++) {
+      if (isLMS(i))
+        s1[j++] = i;
+    }
+    for (int i = 0; i < n1; i++)
+      sa[i] = s1[sa[i]];
+    std::fill(sa + n1, sa + n, -1);
+    bucketEnds(s, n, k, bucket);
+    for (int i = n1 - 1; i >= 0; i--) {
+      int j = sa[i];
+      sa[i] = -1;
+      sa[--bucket[s[j]]] = j;
+    }
+    induce(s, sa, n, k, stype, bucket);
+  }
+
+private:
+  template <typename Text>
+  static void bucketEnds(const Text &s, int n, int k,
+                         std::vector<int> &bucket) {
+    std::fill(bucket.begin(), bucket.end(), 0);
+    for (int i = 0; i < n; i++)
+      bucket[s[i]]++;
+    for (int c = 1; c < k; c++)
+      bucket[c] += bucket[c - 1];
+  }
+
+  template <typename Text>
+  static void bucketStarts(const Text &s, int n, int k,
+                           std::vector<int> &bucket) {
+    bucketEnds(s, n, k, bucket);
+    for (int c = k - 1; c > 0; c--)
+      bucket[c] = bucket[c - 1];
+    bucket[0] = 0;
+  }
+
+  // 由已放好的后缀诱导：从左到右放L型，再从右到左放S型
+  template <typename Text>
+  static void induce(const Text &s, int *sa, int n, int k,
+                     const std::vector<bool> &stype, std::vector<int> &bucket) {
+    bucketStarts(s, n, k, bucket);
+    for (int i = 0; i < n; i++) {
+      int j = sa[i] - 1;
+      if (j >= 0 && !stype[j])
+        sa[bucket[s[j]]++] = j;
+    }
+    bucketEnds(s, n, k, bucket);
+    for (int i = n - 1; i >= 0; i--) {
+      int j = sa[i] - 1;
+      if (j >= 0 && stype[j])
+        sa[--bucket[s[j]]] = j;
+    }
+  }
+};
+
+// 字节串末尾加上哨兵：字节c映射为c + 1，第size个字符为0。
+// 不另外生成int数组，随机访问时占用的缓存只有四分之一
+struct SentinelText {
+  const uint8_t *data;
+  size_t size;
+  int operator[](size_t i) const { return i == size ? 0 : data[i] + 1; }
+};
+
+// --- BWT ---
+// 逆变换沿一条链每输出一个字节做一次随机访问，访存延迟决定了速度。
+// 因此把块等分成BWT_LANES段，压缩时记下每段起点所在的行，解压时同时沿
+// 各段的链前进，几次互不依赖的访存可以重叠
+const int BWT_LANES = 8;
+
+inline size_t bwtLaneLength(size_t size) {
+  return (size + BWT_LANES - 1) / BWT_LANES;
+}
+
+// 对data[0, size)末尾加上虚拟哨兵$后排序全部size + 1个后缀，输出最后一列中
+// 除$以外的size个字节。rows[j]为第j段起点的后缀所在的行，不存在的段为0；
+// rows[0]即$所在的行
+inline void bwtForward(const uint8_t *data, size_t size, uint8_t *out,
+                       uint32_t *rows) {
+  std::fill(rows, rows + BWT_LANES, 0);
+  if (size == 0)
+    return; // SA-IS要求至少有一个非哨兵字符
+  std::vector<int> sa(size + 1);
+  SuffixArrayBuilder().build(SentinelText{data, size}, sa.data(),
+                             (int)size + 1, BYTE_SYMBOLS + 1);
+
+  size_t lane = bwtLaneLength(size);
+  size_t k = 0;
+  for (size_t i = 0; i <= size; i++) {
+    size_t pos = sa[i];
+    if (pos < size && pos % lane == 0)
+      rows[pos / lane] = (uint32_t)i;
+    if (pos != 0)
+      out[k++] = data[pos - 1];
+  }
+}
+
+// 逆变换：next[j]把第一列中第j行链接到下一个后缀所在的行，同时带上该行的
+// 首字节。Entry为uint32_t时行号和字节合成一个32位数（行号需小于2^24），
+// 内存访问量减半
+template <typename Entry>
+void bwtInverseWith(const uint8_t *bwt, size_t size, const uint32_t *rows,
+                    uint8_t *out) {
+  uint64_t starts[BYTE_SYMBOLS] = {0};
+  for (size_t k = 0; k < size; k++)
+    starts[bwt[k]]++;
+  uint64_t sum = 1; // 第0行是哨兵$开头的后缀
+  for (int c = 0; c < BYTE_SYMBOLS; c++) {
+    uint64_t count = starts[c];
+    starts[c] = sum;
+    sum += count;
+  }
+  std::vector<Entry> next(size + 1);
+  size_t primary = rows[0];
+  for (size_t k = 0; k < size; k++) {
+    Entry row = k < primary ? k : k + 1; // 跳过$所在的行
+    next[starts[bwt[k]]++] = (row << 8) | bwt[k];
+  }
+
+  size_t lane = bwtLaneLength(size);
+  int lanes = (int)((size + lane - 1) / lane);
+  size_t lastLength = size - (lanes - 1) * lane; // 只有最后一段可能较短
+  Entry entries[BWT_LANES];
+  for (int j = 0; j < lanes; j++)
+    entries[j] = next[rows[j]];
+  for (size_t i = 0; i < lane; i++) {
+    int active = i < lastLength ? lanes : lanes - 1;
+    for (int j = 0; j < active; j++) {
+      out[j * lane + i] = (uint8_t)entries[j];
+      entries[j] = next[entries[j] >> 8];
+    }
+  }
+}
+
+// rows由bwtForward给出，每个都不能大于size
+inline void bwtInverse(const uint8_t *bwt, size_t size, const uint32_t *rows,
+                       uint8_t *out) {
+  if (size == 0)
+    return;
+  if (size < ((size_t)1 << 24))
+    bwtInverseWith<uint32_t>(bwt, size, rows, out);
+  else
+    bwtInverseWith<uint64_t>(bwt, size, rows, out);
+}
+
+// --- MTF + 零游程 ---
+// 输出字节：RUNA(0)、RUNB(1)表示0的游程；MTF值1~253写为值+1；
+// 很少出现的254、255写为转义字节255再跟原值
+const uint8_t BWT_RUNA = 0;
+const uint8_t BWT_RUNB = 1;
+const uint8_t BWT_ESCAPE = 255;
+
+inline void appendZeroRun(std::vector<uint8_t> &out, size_t run) {
+  while (run > 0) {
+    run--;
+    out.push_back(run & 1 ? BWT_RUNB : BWT_RUNA);
+    run >>= 1;
+  }
+}
+
+inline void mtfEncode(const uint8_t *data, size_t size,
+                      std::vector<uint8_t> &out) {
+  uint8_t order[BYTE_SYMBOLS];
+  for (int c = 0; c < BYTE_SYMBOLS; c++)
+    order[c] = (uint8_t)c;
+  size_t run = 0;
+  for (size_t i = 0; i < size; i++) {
+    uint8_t c = data[i];
+    if (order[0] == c) {
+      run++;
+      continue;
+    }
+    appendZeroRun(out, run);
+    run = 0;
+    int rank = 1;
+    while (order[rank] != c)
+      rank++;
+    memmove(order + 1, order, rank);
+    order[0] = c;
+    if (rank < BWT_ESCAPE - 1) {
+      out.push_back((uint8_t)(rank + 1));
+    } else {
+      out.push_back(BWT_ESCAPE);
+      out.push_back((uint8_t)rank);
+    }
+  }
+  appendZeroRun(out, run);
+}
+
+// 还原出恰好size个字节，输入不合法时返回false
+inline bool mtfDecode(const uint8_t *data, size_t length, uint8_t *out,
+                      size_t size) {
+  uint8_t order[BYTE_SYMBOLS];
+  for (int c = 0; c < BYTE_SYMBOLS; c++)
+    order[c] = (uint8_t)c;
+  size_t pos = 0;
+  for (size_t i = 0; i < length;) {
+    if (data[i] <= BWT_RUNB) {
+      size_t run = 0;
+      for (int shift = 0; i < length && data[i] <= BWT_RUNB; i++, shift++) {
+        if (shift >= 40)
+          return false;
+        run += (size_t)(data[i] + 1) << shift;
+      }
+      if (run > size - pos)
+        return false;
+      memset(out + pos, order[0], run);
+      pos += run;
+      continue;
+    }
+    int rank = data[i++] - 1;
+    if (rank == BWT_ESCAPE - 1) {
+      if (i == length || data[i] < BWT_ESCAPE - 1)
+        return false;
+      rank = data[i++];
+    }
+    if (pos == size)
+      return false;
+    uint8_t c = order[rank];
+    memmove(order + 1, order, rank);
+    order[0] = c;
+    out[pos++] = c;
+  }
+  return pos == size;
+}
+
+// --- 分块编码 ---
+// 块格式：BWT_LANES个4字节的段起点行号 | 4字节MTF输出长度 |
+//         熵编码器对MTF输出的压缩结果
+const size_t BWT_HEADER_SIZE = 4 * BWT_LANES + 4;
+
+inline void bwtEncodeBlock(const char *data, size_t size,
+                           std::vector<uint8_t> &out,
+                           const BlockEncoder &entropyEncoder) {
+  std::vector<uint8_t> transformed(size);
+  uint32_t rows[BWT_LANES];
+  bwtForward((const uint8_t *)data, size, transformed.data(), rows);
+  std::vector<uint8_t> symbols;
+  symbols.reserve(size / 2 + 16);
+  mtfEncode(transformed.data(), size, symbols);
+
+  size_t start = out.size();
+  out.resize(start + BWT_HEADER_SIZE);
+  for (int j = 0; j < BWT_LANES; j++)
+    putLE32(out, start + 4 * j, rows[j]);
+  putLE32(out, start + 4 * BWT_LANES, (uint32_t)symbols.size());
+  entropyEncoder((const char *)symbols.data(), symbols.size(), out);
+}
+
+inline bool bwtDecodeBlock(const uint8_t *data, size_t size, char *out,
+                           size_t originalSize,
+                           const BlockDecoder &entropyDecoder) {
+  if (size < BWT_HEADER_SIZE)
+    return false;
+  uint32_t rows[BWT_LANES];
+  for (int j = 0; j < BWT_LANES; j++) {
+    rows[j] = getLE32(data + 4 * j);
+    if (rows[j] > originalSize)
+      return false;
+  }
+  size_t length = getLE32(data + 4 * BWT_LANES);
+  // 每个字节至多产生两个输出字节（转义）
+  if (length > originalSize * 2)
+    return false;
+  std::vector<uint8_t> symbols(length);
+  if (!entropyDecoder(data + BWT_HEADER_SIZE, size - BWT_HEADER_SIZE,
+                      (char *)symbols.data(), length))
+    return false;
+  std::vector<uint8_t> transformed(originalSize);
+  if (!mtfDecode(symbols.data(), length, transformed.data(), originalSize))
+    return false;
+  bwtInverse(transformed.data(), originalSize, rows, (uint8_t *)out);
+  return true;
+}
+
+inline void bwtHuffmanEncodeBlock(const char *data, size_t size,
+                                  std::vector<uint8_t> &out) {
+  bwtEncodeBlock(data, size, out, huffmanEncodeBlock);
+}
+
+inline bool bwtHuffmanDecodeBlock(const uint8_t *data, size_t size, char *out,
+                                  size_t originalSize) {
+  return bwtDecodeBlock(data, size, out, originalSize, huffmanDecodeBlock);
+}
+
+inline void bwtArithmeticEncodeBlock(const char *data, size_t size,
+                                     std::vector<uint8_t> &out) {
+  bwtEncodeBlock(data, size, out, encode_adaptive_block);
+}
+
+inline bool bwtArithmeticDecodeBlock(const uint8_t *data, size_t size,
+                                     char *out, size_t originalSize) {
+  return bwtDecodeBlock(data, size, out, originalSize, decode_adaptive_block);
+}
@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <malloc.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "BlockFrame.h"
+#include "Codecs.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// 基准测试：对生成的语料（文本、日志、随机、高度重复，多种大小）运行所有编码器，
+// 按分块帧单线程压缩和解压，输出压缩率、吞吐量(MB/s)、单次延迟的p50/p99、
+// 峰值内存，内核允许时还输出每字节周期数。结果另写成JSON，用于比较和回归门槛
+
+// 参加测试的编码器：命令行工具的全部编码器，另加LZ77的最快和最高级别
+struct BenchCodec {
+  string name;
+  BlockEncoder encodeBlock;
+  BlockDecoder decodeBlock;
+};
+
+vector<BenchCodec> benchCodecs() {
+  vector<BenchCodec> list;
+  for (const Codec &codec : codecs())
+    list.push_back({codec.name, codec.encodeBlock, codec.decodeBlock});
+  for (int level : {1, LZ77_MAX_LEVEL}) {
+    LZ77Options options;
+    options.level = level;
+    list.push_back({"lz77-" + to_string(level),
+                    [options](const char *data, size_t size,
+                              vector<uint8_t> &out) {
+                      lz77Encode(data, size, options, out);
+                    },
+                    lz77DecodeBlock});
+  }
+  return list;
+}
+
+// --- 语料生成 ---
+// 固定种子的伪随机数（splitmix64），每次运行生成完全相同的语料
+class Random {
+public:
+  explicit Random(uint64_t seed) : state(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  // [0, n)内的整数
+  size_t below(size_t n) { return (size_t)(next() % n); }
+
+  // 近似Zipf分布的[0, n)内的整数，小的值出现得多
+  size_t zipf(size_t n) {
+    double u = (next() >> 11) * (1.0 / 9007199254740992.0);
+    return min(n - 1, (size_t)(pow((double)n + 1, u) - 1));
+  }
+
+private:
+  uint64_t state;
+};
+
+// 英文风格的文本：由音节拼成的词表，词频服从Zipf分布
+string makeText(size_t size, Random &rng) {
+  const char *syllables[] = {"the", "an", "re", "in", "er", "on", "at", "en",
+                             "ed", "is", "or", "ti", "es", "ar", "te", "al",
+                             "st", "nd", "ou", "ing", "ion", "com", "pro"};
+  const size_t syllableCount = sizeof(syllables) / sizeof(syllables[0]);
+  vector<string> words(4000);
+  for (string &word : words) {
+    for (size_t n = 1 + rng.below(3); n > 0; n--)
+      word += syllables[rng.below(syllableCount)];
+  }
+
+  string text;
+  text.reserve(size + 64);
+  size_t sentence = 0;
+  while (text.size() < size) {
+    string word = words[rng.zipf(words.size())];
+    if (sentence == 0)
+      word[0] = (char)toupper(word[0]);
+    text += word;
+    if (++sentence > 6 + rng.below(12)) {
+      text += rng.below(4) == 0 ? ".\n" : ". ";
+      sentence = 0;
+    } else {
+      text += rng.below(10) == 0 ? ", " : " ";
+    }
+  }
+  text.resize(size);
+  return text;
+}
+
+// 服务日志：时间戳递增，级别、模块、路径和状态码取自少量固定取值
+string makeLogs(size_t size, Random &rng) {
+  const char *levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+  const char *paths[] = {"/api/v1/users", "/api/v1/orders", "/health",
+                         "/api/v1/search", "/static/app.js", "/login"};
+  const int statuses[] = {200, 200, 200, 201, 204, 304, 404, 500};
+  string text;
+  text.reserve(size + 256);
+  uint64_t millis = 1760000000000ULL;
+  while (text.size() < size) {
+    millis += rng.below(50);
+    ostringstream line;
+    line << millis / 1000 << "." << setw(3) << setfill('0') << millis % 1000
+         << " " << levels[rng.below(6)] << " [worker-" << rng.below(16)
+         << "] request id=" << hex << rng.next() % 0xFFFFFFFF << dec
+         << " path=" << paths[rng.zipf(6)]
+         << " status=" << statuses[rng.zipf(8)]
+         << " latency=" << rng.zipf(2000) << "ms\n";
+    text += line.str();
+  }
+  text.resize(size);
+  return text;
+}
+
+// 均匀随机字节，不可压缩
+string makeRandom(size_t size, Random &rng) {
+  string text(size, '\0');
+  for (size_t i = 0; i < size; i++)
+    text[i] = (char)rng.next();
+  return text;
+}
+
+// 高度重复：一小段模式反复出现，偶尔有一个字节被改变
+string makeRepetitive(size_t size, Random &rng) {
+  string pattern = makeText(37, rng);
+  string text;
+  text.reserve(size + pattern.size());
+  while (text.size() < size) {
+    text += pattern;
+    if (rng.below(100) == 0)
+      text[text.size() - 1 - rng.below(pattern.size())] = (char)rng.next();
+  }
+  text.resize(size);
+  return text;
+}
+
+struct Corpus {
+  string name;
+  string text;
+};
+
+vector<Corpus> makeCorpora(size_t size) {
+  Random rng(size);
+  return {{"text", makeText(size, rng)},
+          {"logs", makeLogs(size, rng)},
+          {"random", makeRandom(size, rng)},
+          {"repetitive", makeRepetitive(size, rng)}};
+}
+
+// --- 测量 ---
+// CPU周期计数器（perf_event），内核不允许时unavailable
+class CycleCounter {
+public:
+  CycleCounter() {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  ~CycleCounter() {
+    if (fd >= 0)
+      close(fd);
+  }
+
+  bool available() const { return fd >= 0; }
+
+  void start() {
+    if (fd < 0)
+      return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  uint64_t stop() {
+    uint64_t count = 0;
+    if (fd < 0)
+      return 0;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+      return 0;
+    return count;
+  }
+
+private:
+  int fd;
+};
+
+// 峰值内存：先把空闲的堆内存还给系统，再把VmHWM清为当前的常驻内存，
+// 之后读出的值只反映这一项测试（含语料本身），读不到时为0
+void resetPeakRss() {
+  malloc_trim(0);
+  ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+}
+
+size_t peakRssKiB() {
+  ifstream status("/proc/self/status");
+  string line;
+  while (getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return strtoull(line.c_str() + 6, nullptr, 10);
+  }
+  return 0;
+}
+
+struct Timing {
+  vector<double> seconds; // 每一轮的用时
+  uint64_t cycles = 0;
+  double total() const {
+    double sum = 0;
+    for (double s : seconds)
+      sum += s;
+    return sum;
+  }
+};
+
+// 按最近秩取百分位数，单位ms
+double percentileMs(vector<double> seconds, double p) {
+  sort(seconds.begin(), seconds.end());
+  size_t rank = (size_t)ceil(p * seconds.size());
+  return seconds[max(rank, (size_t)1) - 1] * 1000;
+}
+
+// 先预热一轮，然后至少运行MIN_ROUNDS轮且累计至少MIN_SECONDS秒
+const int MIN_ROUNDS = 5;
+const int MAX_ROUNDS = 1000;
+const double MIN_SECONDS = 0.3;
+
+template <typename Fn> Timing measure(Fn fn, CycleCounter &counter) {
+  fn();
+  Timing timing;
+  counter.start();
+  while ((int)timing.seconds.size() < MIN_ROUNDS ||
+         (timing.total() < MIN_SECONDS &&
+          (int)timing.seconds.size() < MAX_ROUNDS)) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+    timing.seconds.push_back(seconds.count());
+  }
+  timing.cycles = counter.stop();
+  return timing;
+}
+
+struct Result {
+  string codec;
+  string corpus;
+  size_t size;
+  size_t compressed;
+  bool ok;
+  Timing encode, decode;
+  size_t peakRss;
+};
+
+double throughputMBps(const Timing &timing, size_t size) {
+  return (double)size * timing.seconds.size() / timing.total() / 1e6;
+}
+
+// 表格中的一组列：吞吐量、p50、p99
+void printTiming(const Timing &timing, size_t size) {
+  cout << setw(10) << throughputMBps(timing, size) << setw(10)
+       << percentileMs(timing.seconds, 0.5) << setw(10)
+       << percentileMs(timing.seconds, 0.99);
+}
+
+void writeTimingJson(ostream &out, const Timing &timing, size_t size,
+                     bool haveCycles) {
+  double bytes = (double)size * timing.seconds.size();
+  out << "{\"mb_per_s\": " << throughputMBps(timing, size)
+      << ", \"p50_ms\": " << percentileMs(timing.seconds, 0.5)
+      << ", \"p99_ms\": " << percentileMs(timing.seconds, 0.99)
+      << ", \"rounds\": " << timing.seconds.size() << ", \"cycles_per_byte\": ";
+  if (haveCycles && size > 0)
+    out << timing.cycles / bytes;
+  else
+    out << "null";
+  out << "}";
+}
+
+void writeJson(const string &path, const vector<Result> &results,
+               size_t blockSize, bool haveCycles) {
+  ofstream out(path);
+  out << "{\n  \"block_size\": " << blockSize << ",\n  \"results\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    out << (i ? ",\n" : "\n") << "    {\"codec\": \"" << r.codec
+        << "\", \"corpus\": \"" << r.corpus << "\", \"size\": " << r.size
+        << ", \"compressed\": " << r.compressed
+        << ", \"ratio\": " << (double)r.compressed / max(r.size, (size_t)1)
+        << ", \"ok\": " << (r.ok ? "true" : "false")
+        << ", \"peak_rss_kib\": " << r.peakRss << ",\n     \"encode\": ";
+    writeTimingJson(out, r.encode, r.size, haveCycles);
+    out << ",\n     \"decode\": ";
+    writeTimingJson(out, r.decode, r.size, haveCycles);
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+// 逗号分隔的列表
+vector<string> splitList(const string &text) {
+  vector<string> items;
+  stringstream stream(text);
+  string item;
+  while (getline(stream, item, ','))
+    items.push_back(item);
+  return items;
+}
+
+int main(int argc, char *argv[]) {
+  // 用法: Bench.o [-s 大小KiB,...] [-c 编码器,...] [-o 结果.json]
+  vector<size_t> sizes = {64 << 10, 1 << 20};
+  vector<string> selected;
+  string jsonPath = "bench.json";
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-s" && i + 1 < argc) {
+      sizes.clear();
+      for (const string &kib : splitList(argv[++i]))
+        sizes.push_back((size_t)strtoull(kib.c_str(), nullptr, 10) << 10);
+    } else if (arg == "-c" && i + 1 < argc) {
+      selected = splitList(argv[++i]);
+    } else if (arg == "-o" && i + 1 < argc) {
+      jsonPath = argv[++i];
+    } else {
+      cerr << "Usage: " << argv[0]
+           << " [-s KiB,...] [-c codec,...] [-o results.json]" << endl;
+      return 1;
+    }
+  }
+
+  vector<BenchCodec> allCodecs = benchCodecs();
+  vector<BenchCodec> codecList;
+  for (const BenchCodec &codec : allCodecs) {
+    if (selected.empty() ||
+        find(selected.begin(), selected.end(), codec.name) != selected.end())
+      codecList.push_back(codec);
+  }
+
+  ThreadPool pool(1);
+  CycleCounter counter;
+  vector<Result> results;
+  bool allOk = true;
+  cout << fixed << setprecision(2);
+  cout << left << setw(14) << "codec" << setw(12) << "corpus" << right
+       << setw(10) << "size" << setw(8) << "ratio" << setw(10) << "enc MB/s"
+       << setw(10) << "p50 ms" << setw(10) << "p99 ms" << setw(10)
+       << "dec MB/s" << setw(10) << "p50 ms" << setw(10) << "p99 ms"
+       << setw(10) << "RSS KiB" << endl;
+
+  for (size_t size : sizes) {
+    for (const Corpus &corpus : makeCorpora(size)) {
+      for (const BenchCodec &codec : codecList) {
+        Result r;
+        r.codec = codec.name;
+        r.corpus = corpus.name;
+        r.size = size;
+        resetPeakRss();
+
+        vector<uint8_t> frame;
+        r.encode = measure(
+            [&] {
+              frame = compressBlocks(corpus.text, DEFAULT_BLOCK_SIZE, pool,
+                                     codec.encodeBlock);
+            },
+            counter);
+        string decoded;
+        bool decodedOk = true;
+        r.decode = measure(
+            [&] {
+              decodedOk = decompressBlocks(frame, pool, codec.decodeBlock,
+                                           decoded);
+            },
+            counter);
+        r.compressed = frame.size();
+        r.ok = decodedOk && decoded == corpus.text;
+        r.peakRss = peakRssKiB();
+        allOk &= r.ok;
+
+        cout << left << setw(14) << r.codec << setw(12) << r.corpus << right
+             << setw(10) << size << setw(8)
+             << (double)r.compressed / max(size, (size_t)1);
+        printTiming(r.encode, size);
+        printTiming(r.decode, size);
+        cout << setw(10) << r.peakRss << (r.ok ? "" : "  FAILED") << endl;
+        results.push_back(r);
+      }
+    }
+  }
+
+  writeJson(jsonPath, results, DEFAULT_BLOCK_SIZE, counter.available());
+  cout << "Results written to " << jsonPath
+       << (counter.available() ? "" : " (cycle counter unavailable)") << endl;
+  return allOk ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// 紧凑比特流：按字节打包（高位在前），bitCount记录有效比特数
+struct PackedBits {
+  std::vector<uint8_t> bytes;
+  uint64_t bitCount = 0;
+};
+
+// 基于64位累加器的比特写入器，每凑满32位整体写出4个字节
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t> &out) : out(&out) {}
+
+  // 写入value的低n位（0 <= n <= 32）
+  void writeBits(uint64_t value, int n) {
+    if (n == 0)
+      return;
+    acc = (acc << n) | (value & ((1ULL << n) - 1));
+    pending += n;
+    written += n;
+    if (pending >= 32) {
+      pending -= 32;
+      uint32_t word = (uint32_t)(acc >> pending);
+      out->push_back((uint8_t)(word >> 24));
+      out->push_back((uint8_t)(word >> 16));
+      out->push_back((uint8_t)(word >> 8));
+      out->push_back((uint8_t)word);
+    }
+  }
+
+  void writeBit(int bit) { writeBits(bit ? 1 : 0, 1); }
+
+  // 写入count个相同的比特
+  void writeRepeated(int bit, uint64_t count) {
+    uint64_t pattern = bit ? 0xFFFFFFFFULL : 0;
+    for (; count >= 32; count -= 32)
+      writeBits(pattern, 32);
+    writeBits(pattern, (int)count);
+  }
+
+  // 把剩余比特补0到整字节并写出，返回写入的总比特数
+  uint64_t flush() {
+    while (pending >= 8) {
+      pending -= 8;
+      out->push_back((uint8_t)(acc >> pending));
+    }
+    if (pending > 0) {
+      out->push_back((uint8_t)(acc << (8 - pending)));
+      pending = 0;
+    }
+    return written;
+  }
+
+  uint64_t bitCount() const { return written; }
+
+private:
+  std::vector<uint8_t> *out;
+  uint64_t acc = 0;     // 低pending位为尚未写出的比特
+  int pending = 0;      // 累加器中尚未写出的比特数
+  uint64_t written = 0; // 已写入的总比特数
+};
+
+// 基于64位累加器的比特读取器，读到末尾之后返回0
+class BitReader {
+public:
+  BitReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+  explicit BitReader(const PackedBits &bits)
+      : BitReader(bits.bytes.data(), bits.bytes.size()) {}
+
+  // 查看接下来的n位但不消耗（0 <= n <= 32）
+  uint32_t peekBits(int n) {
+    if (avail < n)
+      refill();
+    return n == 0 ? 0 : (uint32_t)(acc >> (64 - n));
+  }
+
+  // 跳过n位，调用前需已用peekBits查看过这n位
+  void skipBits(int n) {
+    acc <<= n;
+    avail -= n;
+    consumed += n;
+  }
+
+  uint32_t readBits(int n) {
+    uint32_t value = peekBits(n);
+    skipBits(n);
+    return value;
+  }
+
+  int readBit() { return (int)readBits(1); }
+
+  // 已消耗的比特数
+  uint64_t position() const { return consumed; }
+
+private:
+  // 补充累加器，使其中至少有56位可用（高位对齐）
+  void refill() {
+    if (pos + 8 <= size) {
+      // 快速路径：一次装入8个字节，只推进完整装入的字节数
+      // 多装入的低位在下次补充时会被相同的数据再次或入，因此无害
+      const uint8_t *p = data + pos;
+      uint64_t word = ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+                      ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+                      ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+                      ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+      acc |= word >> avail;
+      int take = (63 - avail) >> 3;
+      pos += take;
+      avail += take * 8;
+      return;
+    }
+    while (avail <= 56) {
+      uint64_t byte = pos < size ? data[pos] : 0;
+      pos++;
+      acc |= byte << (56 - avail);
+      avail += 8;
+    }
+  }
+
+  const uint8_t *data;
+  size_t size;
+  size_t pos = 0;        // 下一个要装入的字节
+  uint64_t acc = 0;      // 高avail位为可用比特
+  int avail = 0;         // 累加器中可用的比特数
+  uint64_t consumed = 0; // 已消耗的比特数
+};
+
+// 把ASCII '0'/'1' 字符串打包成紧凑比特流，忽略其他字符（如换行）
+inline PackedBits packBitString(const std::string &bitString) {
+  PackedBits packed;
+  packed.bytes.reserve(bitString.size() / 8 + 1);
+  BitWriter writer(packed.bytes);
+  for (char c : bitString) {
+    if (c == '0' || c == '1')
+      writer.writeBit(c - '0');
+  }
+  packed.bitCount = writer.flush();
+  return packed;
+}
+
+// 文件格式：8字节小端序比特数 + 打包后的字节
+inline bool savePackedBits(const std::string &path, const PackedBits &bits) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  uint8_t header[8];
+  for (int i = 0; i < 8; i++)
+    header[i] = (uint8_t)(bits.bitCount >> (8 * i));
+  file.write((const char *)header, 8);
+  file.write((const char *)bits.bytes.data(), bits.bytes.size());
+  return (bool)file;
+}
+
+inline bool loadPackedBits(const std::string &path, PackedBits &bits) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  uint8_t header[8];
+  if (!file.read((char *)header, 8))
+    return false;
+  bits.bitCount = 0;
+  for (int i = 0; i < 8; i++)
+    bits.bitCount |= (uint64_t)header[i] << (8 * i);
+  bits.bytes.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+  return bits.bytes.size() * 8 >= bits.bitCount;
+}
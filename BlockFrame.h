@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// 独立分块帧格式（小端序）：
+//   8字节原始总长度 | 4字节块大小 | 每块4字节压缩后大小 | 各块压缩数据
+// 每块使用自己的模型/码表独立压缩，因此压缩和解压都可以按块并行，
+// 输出只取决于块大小，与线程数无关
+const size_t DEFAULT_BLOCK_SIZE = (size_t)1 << 20;
+
+// 压缩一块：输入原始数据，追加压缩结果到out
+using BlockEncoder = std::function<void(const char *data, size_t size,
+                                        std::vector<uint8_t> &out)>;
+// 解压一块：输入压缩数据，向out写出恰好originalSize个字节，失败返回false
+using BlockDecoder = std::function<bool(const uint8_t *data, size_t size,
+                                        char *out, size_t originalSize)>;
+
+inline void putLE32(std::vector<uint8_t> &out, size_t offset, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    out[offset + i] = (uint8_t)(value >> (8 * i));
+}
+
+inline void putLE64(std::vector<uint8_t> &out, size_t offset, uint64_t value) {
+  putLE32(out, offset, (uint32_t)value);
+  putLE32(out, offset + 4, (uint32_t)(value >> 32));
+}
+
+inline uint32_t getLE32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+inline uint64_t getLE64(const uint8_t *p) {
+  return (uint64_t)getLE32(p) | ((uint64_t)getLE32(p + 4) << 32);
+}
+
+inline size_t blockCountFor(uint64_t totalSize, size_t blockSize) {
+  return (size_t)((totalSize + blockSize - 1) / blockSize);
+}
+
+inline std::vector<uint8_t> compressBlocks(const std::string &input,
+                                           size_t blockSize, ThreadPool &pool,
+                                           const BlockEncoder &encodeBlock) {
+  size_t blocks = blockCountFor(input.size(), blockSize);
+  std::vector<std::vector<uint8_t>> payloads(blocks);
+  pool.parallelFor(blocks, [&](size_t b) {
+    size_t begin = b * blockSize;
+    size_t size = std::min(blockSize, input.size() - begin);
+    encodeBlock(input.data() + begin, size, payloads[b]);
+  });
+
+  // 按块顺序拼接，保证输出与线程数无关
+  std::vector<uint8_t> frame(12 + 4 * blocks);
+  putLE64(frame, 0, input.size());
+  putLE32(frame, 8, (uint32_t)blockSize);
+  size_t payloadSize = 0;
+  for (size_t b = 0; b < blocks; b++) {
+    putLE32(frame, 12 + 4 * b, (uint32_t)payloads[b].size());
+    payloadSize += payloads[b].size();
+  }
+  frame.reserve(frame.size() + payloadSize);
+  for (const std::vector<uint8_t> &payload : payloads)
+    frame.insert(frame.end(), payload.begin(), payload.end());
+  return frame;
+}
+
+// 解压整个帧，格式错误时返回false。帧头不可信：块大小不超过maxBlockSize，
+// 块数先与块大小表的长度比较再做乘法，各块长度之和必须恰好延伸到帧尾。
+// 这样计算不会回绕，分配的输出也不超过 块大小表的项数×maxBlockSize
+inline bool decompressBlocks(const std::vector<uint8_t> &frame,
+                             ThreadPool &pool, const BlockDecoder &decodeBlock,
+                             std::string &output,
+                             size_t maxBlockSize = (size_t)64 << 20) {
+  if (frame.size() < 12)
+    return false;
+  uint64_t total = getLE64(frame.data());
+  size_t blockSize = getLE32(frame.data() + 8);
+  if (blockSize == 0 || blockSize > maxBlockSize)
+    return false;
+  // total接近2^64时blockCountFor会回绕，这里分开求商和余数
+  uint64_t blocks = total / blockSize + (total % blockSize != 0);
+  if (blocks > (frame.size() - 12) / 4 || total > output.max_size())
+    return false;
+
+  // 由块大小表求出每块压缩数据的位置
+  std::vector<size_t> offsets(blocks + 1);
+  offsets[0] = 12 + 4 * blocks;
+  for (size_t b = 0; b < blocks; b++) {
+    offsets[b + 1] = offsets[b] + getLE32(frame.data() + 12 + 4 * b);
+  }
+  if (offsets[blocks] != frame.size())
+    return false;
+
+  output.assign(total, '\0');
+  std::atomic<bool> ok{true};
+  pool.parallelFor(blocks, [&](size_t b) {
+    size_t begin = b * blockSize;
+    size_t size = std::min((uint64_t)blockSize, total - begin);
+    if (!decodeBlock(frame.data() + offsets[b], offsets[b + 1] - offsets[b],
+                     &output[begin], size))
+      ok = false;
+  });
+  return ok;
+}
+
+// 测试分块帧：检查往返正确、单线程与多线程输出逐字节相同，并输出吞吐量
+inline bool reportBlockFrame(const std::string &text, size_t blockSize,
+                             const BlockEncoder &encodeBlock,
+                             const BlockDecoder &decodeBlock) {
+  ThreadPool single(1);
+  ThreadPool pool(ThreadPool::defaultThreads());
+
+  std::vector<uint8_t> frame =
+      compressBlocks(text, blockSize, pool, encodeBlock);
+  std::string decoded;
+  bool ok = decompressBlocks(frame, pool, decodeBlock, decoded) &&
+            decoded == text &&
+            frame == compressBlocks(text, blockSize, single, encodeBlock);
+  std::cout << "Block Frame: " << (ok ? "OK" : "FAILED") << ", "
+            << frame.size() << " / " << text.size() << " bytes, "
+            << blockCountFor(text.size(), blockSize) << " blocks of "
+            << blockSize / 1024 << " KiB" << std::endl;
+
+  // 分别用1个线程和全部线程计时，输出MB/s
+  auto throughput = [&](ThreadPool &p, bool encode) {
+    const int rounds = 10;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      if (encode)
+        compressBlocks(text, blockSize, p, encodeBlock);
+      else
+        decompressBlocks(frame, p, decodeBlock, decoded);
+    }
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    return text.size() * rounds / seconds.count() / 1e6;
+  };
+  std::cout << "Block Encoding: " << throughput(single, true)
+            << " MB/s (1 thread), " << throughput(pool, true) << " MB/s ("
+            << pool.size() << " threads)" << std::endl;
+  std::cout << "Block Decoding: " << throughput(single, false)
+            << " MB/s (1 thread), " << throughput(pool, false) << " MB/s ("
+            << pool.size() << " threads)" << std::endl;
+  return ok;
+}
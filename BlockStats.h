@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "ByteModel.h"
+
+// 块的快速统计，用于为每块选择编码器。一次遍历同时得到：
+//   零阶熵：决定零阶熵编码器（霍夫曼、rANS等）能压到多小
+//   重复比例：与前一个字节相同的字节所占比例，长的连续重复适合LZ
+//   匹配密度：每隔STATS_SAMPLE_STRIDE个位置抽样，查哈希表看前面
+//             STATS_MAX_DISTANCE之内是否出现过相同的4个字节，命中的比例
+//   匹配长度：命中位置向后比较得到的平均匹配长度（最多STATS_MAX_MATCH）
+struct BlockStats {
+  double entropy = 0;      // 比特/字节
+  double runFraction = 0;  // 0~1
+  double matchDensity = 0; // 0~1
+  double matchLength = 0;  // 字节
+};
+
+const int STATS_HASH_BITS = 12;
+const size_t STATS_SAMPLE_STRIDE = 4;
+const size_t STATS_MAX_DISTANCE = (size_t)1 << 16; // 与LZ77默认窗口相同
+const size_t STATS_MAX_MATCH = 64;
+
+// a、b开头的公共长度，最多limit字节，每次比较8个字节
+inline size_t sampleMatchLength(const uint8_t *a, const uint8_t *b,
+                                size_t limit) {
+  size_t length = 0;
+  for (; length + 8 <= limit; length += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + length, 8);
+    memcpy(&y, b + length, 8);
+    if (x != y)
+      return length + (__builtin_ctzll(x ^ y) >> 3); // 小端序
+  }
+  while (length < limit && a[length] == b[length])
+    length++;
+  return length;
+}
+
+inline BlockStats computeBlockStats(const uint8_t *data, size_t size) {
+  BlockStats stats;
+  if (size == 0)
+    return stats;
+
+  uint64_t freqs[BYTE_SYMBOLS] = {0};
+  uint32_t table[1 << STATS_HASH_BITS] = {0}; // 4字节哈希 -> 最近位置+1
+  uint64_t runs = 0, samples = 0, matches = 0, matchBytes = 0;
+  freqs[data[0]]++;
+  for (size_t i = 1; i < size; i++) {
+    freqs[data[i]]++;
+    runs += data[i] == data[i - 1];
+    if (i + 4 > size)
+      continue;
+    uint32_t word;
+    memcpy(&word, data + i, 4);
+    uint32_t &slot = table[(word * 2654435761u) >> (32 - STATS_HASH_BITS)];
+    if (i % STATS_SAMPLE_STRIDE == 0) {
+      samples++;
+      if (slot != 0 && i - (slot - 1) <= STATS_MAX_DISTANCE &&
+          memcmp(data + slot - 1, data + i, 4) == 0) {
+        matches++;
+        matchBytes += sampleMatchLength(data + slot - 1, data + i,
+                                        std::min(STATS_MAX_MATCH, size - i));
+      }
+    }
+    slot = (uint32_t)i + 1;
+  }
+
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    if (freqs[s] == 0)
+      continue;
+    double prob = (double)freqs[s] / size;
+    stats.entropy -= prob * log2(prob);
+  }
+  stats.runFraction = (double)runs / size;
+  stats.matchDensity = samples ? (double)matches / samples : 0;
+  stats.matchLength = matches ? (double)matchBytes / matches : 0;
+  return stats;
+}
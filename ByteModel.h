@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 所有编码器共用的字节模型：按unsigned char下标的256项平坦数组，
+// 字节值>=0x80的二进制数据也能正确处理
+const int BYTE_SYMBOLS = 256;
+
+// 统计字节频率。使用4组子直方图轮流计数，相邻的相同字节落在不同的计数器上，
+// 避免对同一计数器的写后读依赖，使计数速度接近内存带宽
+inline void countByteFrequencies(const uint8_t *data, size_t size,
+                                 uint64_t *freqs) {
+  // 子直方图用32位计数，每处理一段就累加到64位结果中，防止溢出
+  const size_t CHUNK = (size_t)1 << 30;
+  uint32_t lanes[4][BYTE_SYMBOLS];
+
+  while (size > 0) {
+    size_t n = size < CHUNK ? size : CHUNK;
+    memset(lanes, 0, sizeof(lanes));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      lanes[0][(uint8_t)word]++;
+      lanes[1][(uint8_t)(word >> 8)]++;
+      lanes[2][(uint8_t)(word >> 16)]++;
+      lanes[3][(uint8_t)(word >> 24)]++;
+      lanes[0][(uint8_t)(word >> 32)]++;
+      lanes[1][(uint8_t)(word >> 40)]++;
+      lanes[2][(uint8_t)(word >> 48)]++;
+      lanes[3][(uint8_t)(word >> 56)]++;
+    }
+    for (; i < n; i++) {
+      lanes[0][data[i]]++;
+    }
+    for (int s = 0; s < BYTE_SYMBOLS; s++) {
+      freqs[s] += (uint64_t)lanes[0][s] + lanes[1][s] + lanes[2][s] +
+                  lanes[3][s];
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+inline std::vector<uint64_t> countByteFrequencies(const std::string &text) {
+  std::vector<uint64_t> freqs(BYTE_SYMBOLS, 0);
+  countByteFrequencies((const uint8_t *)text.data(), text.size(),
+                       freqs.data());
+  return freqs;
+}
+
+// 由字节频率计算零阶信源熵（比特/字节）
+inline double orderZeroEntropy(const std::vector<uint64_t> &freqs) {
+  uint64_t total = 0;
+  for (uint64_t f : freqs)
+    total += f;
+  double entropy = 0.0;
+  for (uint64_t f : freqs) {
+    if (f == 0)
+      continue;
+    double prob = (double)f / total; // 计算概率
+    entropy -= prob * log2(prob);    // 计算熵
+  }
+  return entropy;
+}
+
+// 变长整数：每字节7位，最高位表示后面还有字节
+inline void appendVarint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+inline bool readVarint(const uint8_t *data, size_t size, size_t &pos,
+                       uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && pos < size; shift += 7) {
+    uint8_t byte = data[pos++];
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// 字节出现标记：32字节的位图，第s位表示字节s是否出现
+inline void appendPresenceBitmap(std::vector<uint8_t> &out,
+                                 const std::vector<uint64_t> &freqs) {
+  for (int i = 0; i < BYTE_SYMBOLS / 8; i++) {
+    uint8_t bits = 0;
+    for (int j = 0; j < 8; j++)
+      bits |= (freqs[i * 8 + j] > 0) << j;
+    out.push_back(bits);
+  }
+}
+
+// 读出位图，出现的字节频率置为1
+inline bool readPresenceBitmap(const uint8_t *data, size_t size, size_t &pos,
+                               std::vector<uint64_t> &freqs) {
+  if (pos + BYTE_SYMBOLS / 8 > size)
+    return false;
+  freqs.assign(BYTE_SYMBOLS, 0);
+  for (int s = 0; s < BYTE_SYMBOLS; s++)
+    freqs[s] = (data[pos + s / 8] >> (s % 8)) & 1;
+  pos += BYTE_SYMBOLS / 8;
+  return true;
+}
+
+// 频率表：出现标记位图 + 每个出现字节的频率（变长整数）
+inline void appendFrequencyHeader(std::vector<uint8_t> &out,
+                                  const std::vector<uint64_t> &freqs) {
+  appendPresenceBitmap(out, freqs);
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    if (freqs[s] > 0)
+      appendVarint(out, freqs[s]);
+  }
+}
+
+// 读出频率表。编码端的频率之和就是块的原始长度total，和不等于total、
+// 出现的字节频率为0时都视为损坏，这样全0的频率表和累加溢出都不会传给模型
+inline bool readFrequencyHeader(const uint8_t *data, size_t size, size_t &pos,
+                                std::vector<uint64_t> &freqs, uint64_t total) {
+  if (!readPresenceBitmap(data, size, pos, freqs))
+    return false;
+  uint64_t sum = 0;
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    if (freqs[s] == 0)
+      continue;
+    if (!readVarint(data, size, pos, freqs[s]) || freqs[s] == 0 ||
+        freqs[s] > total - sum)
+      return false;
+    sum += freqs[s];
+  }
+  return sum == total;
+}
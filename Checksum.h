@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+// CRC32C（Castagnoli多项式，反射形式0x82F63B78）。x86-64上CPU支持SSE4.2时
+// 用crc32指令每次处理8字节；否则用8张查找表每次处理8字节（slicing-by-8）
+const uint32_t CRC32C_POLY = 0x82F63B78;
+
+struct Crc32cTables {
+  uint32_t table[8][256];
+
+  Crc32cTables() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++)
+        crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+      table[0][i] = crc;
+    }
+    // table[k][i]为字节i之后再跟k个0字节的CRC
+    for (int k = 1; k < 8; k++) {
+      for (int i = 0; i < 256; i++)
+        table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+    }
+  }
+};
+
+inline uint32_t crc32cPortable(uint32_t crc, const uint8_t *p, size_t size) {
+  static const Crc32cTables tables;
+  const uint32_t(*t)[256] = tables.table;
+  for (; size >= 8; p += 8, size -= 8) {
+    uint32_t lo, hi;
+    memcpy(&lo, p, 4);
+    memcpy(&hi, p + 4, 4);
+    lo ^= crc; // 小端序
+    crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^
+          t[4][lo >> 24] ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^
+          t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+  }
+  for (; size > 0; p++, size--)
+    crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+  return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) inline uint32_t
+crc32cHardware(uint32_t crc, const uint8_t *p, size_t size) {
+  uint64_t crc64 = crc;
+  for (; size >= 8; p += 8, size -= 8) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = (uint32_t)crc64;
+  for (; size > 0; p++, size--)
+    crc = _mm_crc32_u8(crc, *p);
+  return crc;
+}
+#endif
+
+// 计算data的CRC32C。crc为前面数据的结果，可以分段累加，第一段传0
+inline uint32_t crc32c(const void *data, size_t size, uint32_t crc = 0) {
+  const uint8_t *p = (const uint8_t *)data;
+#if defined(__x86_64__)
+  static const bool hardware = __builtin_cpu_supports("sse4.2");
+  if (hardware)
+    return ~crc32cHardware(~crc, p, size);
+#endif
+  return ~crc32cPortable(~crc, p, size);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Arithmetic.h"
+#include "BlockFrame.h"
+#include "BlockStats.h"
+#include "BWT.h"
+#include "Huffman.h"
+#include "LZ.h"
+#include "LZ78Pipeline.h"
+
+// 不压缩，原样保存，用于不可压缩的块
+inline void storedEncodeBlock(const char *data, size_t size,
+                              std::vector<uint8_t> &out) {
+  out.insert(out.end(), data, data + size);
+}
+
+inline bool storedDecodeBlock(const uint8_t *data, size_t size, char *out,
+                              size_t originalSize) {
+  if (size != originalSize)
+    return false;
+  if (size > 0)
+    memcpy(out, data, size);
+  return true;
+}
+
+inline void autoEncodeBlock(const char *data, size_t size,
+                            std::vector<uint8_t> &out);
+inline bool autoDecodeBlock(const uint8_t *data, size_t size, char *out,
+                            size_t originalSize);
+
+// 命令行工具可选的编码器。下标作为编码器编号写入压缩文件，
+// 已有的编号不能改变，新的编码器只能追加在末尾
+struct Codec {
+  const char *name;
+  BlockEncoder encodeBlock;
+  BlockDecoder decodeBlock;
+};
+
+inline const std::vector<Codec> &codecs() {
+  static const std::vector<Codec> list = {
+      {"huffman", huffmanEncodeBlock, huffmanDecodeBlock},
+      {"lz78", lz78EncodeBlock, lz78DecodeBlock},
+      {"lz77", lz77EncodeBlock, lz77DecodeBlock},
+      {"arithmetic", arithmetic_encode_block, arithmetic_decode_block},
+      {"adaptive", encode_adaptive_block, decode_adaptive_block},
+      {"context", encode_context_block, decode_context_block},
+      {"rans", rans_encode_block, rans_decode_block},
+      {"range", range_encode_block, range_decode_block},
+      {"stored", storedEncodeBlock, storedDecodeBlock},
+      {"auto", autoEncodeBlock, autoDecodeBlock},
+      {"lz78-huffman", lz78HuffmanEncodeBlock, lz78HuffmanDecodeBlock},
+      {"lz78-arith", lz78ArithmeticEncodeBlock, lz78ArithmeticDecodeBlock},
+      {"bwt-huffman", bwtHuffmanEncodeBlock, bwtHuffmanDecodeBlock},
+      {"bwt-arith", bwtArithmeticEncodeBlock, bwtArithmeticDecodeBlock},
+  };
+  return list;
+}
+
+// 按名字查找编码器，返回编号，找不到时返回-1
+inline int findCodec(const std::string &name) {
+  for (size_t i = 0; i < codecs().size(); i++) {
+    if (name == codecs()[i].name)
+      return (int)i;
+  }
+  return -1;
+}
+
+// 由块统计估计候选编码器压缩后的大小（字节/字节），选出编码器编号：
+//   零阶熵编码：熵/8，另加约300字节的频率表
+//   LZ77：未被匹配覆盖的字节原样输出，每个匹配约3字节（标记和偏移），
+//         覆盖比例取匹配密度和重复比例中较大的
+// LZ77编码比rANS慢一个数量级，只有估计小15%以上时才选它；
+// 两者都省不到3%时原样保存
+inline int chooseCodec(const BlockStats &stats, size_t size) {
+  if (size == 0)
+    return findCodec("stored");
+  double orderZero = stats.entropy / 8 + 300.0 / size;
+  double coverage = std::max(stats.matchDensity, stats.runFraction);
+  double lz = 1 - coverage;
+  if (stats.matchLength > 0)
+    lz += coverage * 3 / stats.matchLength;
+  double best = std::min(orderZero, lz);
+  if (best > 0.97)
+    return findCodec("stored");
+  return lz < orderZero * 0.85 ? findCodec("lz77") : findCodec("rans");
+}
+
+// 自动选择：块前1字节为所选编码器的编号，之后是该编码器的输出。
+// 估计不准时所选编码器的输出可能不比原文小，这时改为原样保存，
+// 块最多比原文多出编号的1字节
+inline void autoEncodeBlock(const char *data, size_t size,
+                            std::vector<uint8_t> &out) {
+  BlockStats stats = computeBlockStats((const uint8_t *)data, size);
+  int codecId = chooseCodec(stats, size);
+  int storedId = findCodec("stored");
+  size_t start = out.size();
+  out.push_back((uint8_t)codecId);
+  codecs()[codecId].encodeBlock(data, size, out);
+  if (codecId != storedId && out.size() - start - 1 >= size) {
+    out.resize(start);
+    out.push_back((uint8_t)storedId);
+    storedEncodeBlock(data, size, out);
+  }
+}
+
+inline bool autoDecodeBlock(const uint8_t *data, size_t size, char *out,
+                            size_t originalSize) {
+  if (size == 0 || data[0] >= codecs().size() || data[0] == findCodec("auto"))
+    return false;
+  return codecs()[data[0]].decodeBlock(data + 1, size - 1, out, originalSize);
+}
@@ -0,0 +1,241 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Codecs.h"
+#include "Container.h"
+#include "FileIO.h"
+#include "Seekable.h"
+#include "Stream.h"
+
+using namespace std;
+
+// 压缩文件格式见Container.h，带索引时见Seekable.h
+
+const size_t MAX_BLOCK_SIZE = (size_t)64 << 20;
+const size_t READ_CHUNK_SIZE = (size_t)64 << 10; // 解压时每次读入的字节数
+
+// seekable为true时在结束标记之后追加块索引
+bool compressStream(int inFd, int outFd, int codecId, size_t blockSize,
+                    bool seekable) {
+  // 每次取一整块，mmap输入时整块直接压缩，不经过缓冲区
+  InputFile input(inFd, blockSize);
+  ContainerHeader header;
+  header.codecId = codecId;
+  if (!input.knownSize(header.originalLength))
+    header.originalLength = UNKNOWN_LENGTH;
+  vector<uint8_t> out;
+  appendContainerHeader(out, header);
+
+  StreamCompressor compressor(checkedEncoder(codecs()[codecId].encodeBlock),
+                              blockSize);
+  const char *data;
+  size_t size;
+  while (true) {
+    if (!input.next(data, size)) {
+      cerr << "Failed to read input: " << strerror(errno) << endl;
+      return false;
+    }
+    if (size == 0)
+      break;
+    compressor.update(data, size, out);
+    if (!writeAll(outFd, out.data(), out.size()))
+      return false;
+    out.clear();
+  }
+  compressor.finish(out);
+  if (seekable)
+    appendSeekIndex(out, compressor.index(), CONTAINER_HEADER_SIZE);
+  return writeAll(outFd, out.data(), out.size());
+}
+
+bool decompressStream(int inFd, int outFd) {
+  InputFile input(inFd, READ_CHUNK_SIZE);
+  vector<uint8_t> headerBytes;
+  ContainerHeader header;
+  unique_ptr<StreamDecompressor> decompressor;
+  uint64_t total = 0;
+  string out;
+  const char *data;
+  size_t size;
+  while (true) {
+    if (!input.next(data, size)) {
+      cerr << "Failed to read input: " << strerror(errno) << endl;
+      return false;
+    }
+    if (size == 0)
+      break;
+    // 先凑齐文件头，由其中的编码器编号创建解压器
+    if (!decompressor) {
+      size_t n = min(size, CONTAINER_HEADER_SIZE - headerBytes.size());
+      headerBytes.insert(headerBytes.end(), data, data + n);
+      data += n;
+      size -= n;
+      if (headerBytes.size() < CONTAINER_HEADER_SIZE)
+        continue;
+      if (!readContainerHeader(headerBytes.data(), header)) {
+        cerr << "Not a compressed file or unsupported version" << endl;
+        return false;
+      }
+      decompressor.reset(new StreamDecompressor(
+          checkedDecoder(codecs()[header.codecId].decodeBlock),
+          MAX_BLOCK_SIZE));
+    }
+    if (!decompressor->update((const uint8_t *)data, size, out)) {
+      cerr << "Corrupt input or checksum mismatch" << endl;
+      return false;
+    }
+    total += out.size();
+    if (!writeAll(outFd, out.data(), out.size()))
+      return false;
+    out.clear();
+  }
+  if (!decompressor || !decompressor->done()) {
+    cerr << "Truncated input" << endl;
+    return false;
+  }
+  if (header.originalLength != UNKNOWN_LENGTH &&
+      total != header.originalLength) {
+    cerr << "Length mismatch: " << total << " / " << header.originalLength
+         << " bytes" << endl;
+    return false;
+  }
+  return true;
+}
+
+// 从带索引的压缩文件中解压原始数据[offset, offset + length)。
+// 需要随机访问，输入必须是普通文件
+bool readRange(int inFd, int outFd, uint64_t offset, uint64_t length) {
+  struct stat st;
+  if (fstat(inFd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    cerr << "Range reads need a seekable compressed file" << endl;
+    return false;
+  }
+  size_t size = st.st_size;
+  void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, inFd, 0);
+  if (p == MAP_FAILED) {
+    cerr << "Failed to map input: " << strerror(errno) << endl;
+    return false;
+  }
+  SeekableReader reader;
+  string out;
+  bool ok = reader.open((const uint8_t *)p, size);
+  if (!ok) {
+    cerr << "Missing or corrupt block index" << endl;
+  } else if (offset > reader.length() || length > reader.length() - offset) {
+    cerr << "Range exceeds " << reader.length() << " bytes" << endl;
+    ok = false;
+  }
+  // 按块解压写出，内存占用与范围大小无关
+  for (uint64_t end = offset + length; ok && offset < end;) {
+    uint64_t n = min<uint64_t>(end - offset, READ_CHUNK_SIZE);
+    out.clear();
+    ok = reader.read(offset, n, out) && writeAll(outFd, out.data(), n);
+    offset += n;
+  }
+  munmap(p, size);
+  return ok;
+}
+
+void printUsage(const char *program) {
+  cerr << "Usage: " << program
+       << " [-d [-r offset:length]] [-c codec] [-b block KiB] [-s]"
+          " [input|- [output|-]]"
+       << endl;
+  cerr << "Codecs:";
+  for (const Codec &codec : codecs())
+    cerr << " " << codec.name;
+  cerr << endl;
+}
+
+int main(int argc, char *argv[]) {
+  // 用法: Compress.o [-d [-r 偏移:长度]] [-c 编码器] [-b 块大小KiB] [-s]
+  //       [输入 [输出]]，输入输出省略或为"-"时使用标准输入输出，可以用在管道中。
+  // -s 压缩时追加块索引，-r 只解压原始数据中的一段（输入须为带索引的文件）
+  bool decompress = false;
+  bool seekable = false;
+  bool range = false;
+  uint64_t rangeOffset = 0, rangeLength = 0;
+  int codecId = findCodec("auto");
+  size_t blockSize = DEFAULT_BLOCK_SIZE;
+  vector<string> paths;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-d") {
+      decompress = true;
+    } else if (arg == "-s") {
+      seekable = true;
+    } else if (arg == "-r" && i + 1 < argc) {
+      char *end;
+      rangeOffset = strtoull(argv[++i], &end, 10);
+      if (*end != ':') {
+        printUsage(argv[0]);
+        return 1;
+      }
+      rangeLength = strtoull(end + 1, nullptr, 10);
+      range = true;
+    } else if (arg == "-c" && i + 1 < argc) {
+      codecId = findCodec(argv[++i]);
+      if (codecId < 0) {
+        cerr << "Unknown codec " << argv[i] << endl;
+        printUsage(argv[0]);
+        return 1;
+      }
+    } else if (arg == "-b" && i + 1 < argc) {
+      blockSize = (size_t)strtoull(argv[++i], nullptr, 10) << 10;
+      if (blockSize == 0 || blockSize > MAX_BLOCK_SIZE) {
+        cerr << "Block size must be 1 to " << (MAX_BLOCK_SIZE >> 10) << " KiB"
+             << endl;
+        return 1;
+      }
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      printUsage(argv[0]);
+      return 1;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() > 2 || (range && !decompress)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  int inFd = STDIN_FILENO;
+  int outFd = STDOUT_FILENO;
+  if (paths.size() > 0 && paths[0] != "-") {
+    inFd = open(paths[0].c_str(), O_RDONLY);
+    if (inFd < 0) {
+      cerr << "Failed to open " << paths[0] << endl;
+      return 1;
+    }
+  }
+  if (paths.size() > 1 && paths[1] != "-") {
+    outFd = open(paths[1].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0) {
+      cerr << "Failed to open " << paths[1] << endl;
+      return 1;
+    }
+  }
+
+  bool ok;
+  if (range)
+    ok = readRange(inFd, outFd, rangeOffset, rangeLength);
+  else if (decompress)
+    ok = decompressStream(inFd, outFd);
+  else
+    ok = compressStream(inFd, outFd, codecId, blockSize, seekable);
+  if (outFd != STDOUT_FILENO && close(outFd) != 0)
+    ok = false;
+  if (!ok)
+    cerr << (decompress ? "Decompression" : "Compression") << " failed" << endl;
+  return ok ? 0 : 1;
+}
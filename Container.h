@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "BlockFrame.h"
+#include "Checksum.h"
+#include "Codecs.h"
+
+// 压缩文件格式（小端序）：
+//   4字节魔数"DCMP" | 1字节版本 | 1字节编码器编号 | 8字节原始总长度 |
+//   Stream.h的流式分块数据
+// 输入来自管道、事先不知道长度时总长度为UNKNOWN_LENGTH。
+// 流中每块的压缩数据为4字节原始数据的CRC32C + 编码器输出，编码器输出以本块的
+// 模型开头（频率表、码长或出现字节位图），解压只需要压缩文件本身，
+// 不读取任何文本码表，也不依赖压缩时的进程状态
+const uint8_t CONTAINER_MAGIC[4] = {'D', 'C', 'M', 'P'};
+const uint8_t CONTAINER_VERSION = 1;
+const size_t CONTAINER_HEADER_SIZE = 14;
+const uint64_t UNKNOWN_LENGTH = ~(uint64_t)0;
+
+struct ContainerHeader {
+  int codecId = 0;
+  uint64_t originalLength = UNKNOWN_LENGTH;
+};
+
+inline void appendContainerHeader(std::vector<uint8_t> &out,
+                                  const ContainerHeader &header) {
+  size_t start = out.size();
+  out.insert(out.end(), CONTAINER_MAGIC, CONTAINER_MAGIC + 4);
+  out.push_back(CONTAINER_VERSION);
+  out.push_back((uint8_t)header.codecId);
+  out.resize(start + CONTAINER_HEADER_SIZE);
+  putLE64(out, start + 6, header.originalLength);
+}
+
+// 解析CONTAINER_HEADER_SIZE字节的文件头，魔数、版本或编码器编号不对时返回false
+inline bool readContainerHeader(const uint8_t *data, ContainerHeader &header) {
+  if (memcmp(data, CONTAINER_MAGIC, 4) != 0 || data[4] != CONTAINER_VERSION ||
+      data[5] >= codecs().size())
+    return false;
+  header.codecId = data[5];
+  header.originalLength = getLE64(data + 6);
+  return true;
+}
+
+// 给块编码器加上校验：压缩时在块前写入原始数据的CRC32C
+inline BlockEncoder checkedEncoder(const BlockEncoder &encodeBlock) {
+  return [encodeBlock](const char *data, size_t size,
+                       std::vector<uint8_t> &out) {
+    size_t start = out.size();
+    out.resize(start + 4);
+    putLE32(out, start, crc32c(data, size));
+    encodeBlock(data, size, out);
+  };
+}
+
+// 解压后重新计算CRC32C并与块前记录的比较，不一致时返回false
+inline BlockDecoder checkedDecoder(const BlockDecoder &decodeBlock) {
+  return [decodeBlock](const uint8_t *data, size_t size, char *out,
+                       size_t originalSize) {
+    return size >= 4 && decodeBlock(data + 4, size - 4, out, originalSize) &&
+           crc32c(out, originalSize) == getLE32(data);
+  };
+}
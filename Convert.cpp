@@ -0,0 +1,49 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "BitIO.h"
+
+using namespace std;
+
+// 把旧版ASCII '0'/'1' 编码结果文件转换为紧凑的二进制格式
+bool convertLegacyFile(const string &inputPath, const string &outputPath) {
+  ifstream file(inputPath);
+  if (!file.is_open()) {
+    cerr << "Failed to open " << inputPath << endl;
+    return false;
+  }
+  string bitString((istreambuf_iterator<char>(file)),
+                   istreambuf_iterator<char>());
+  file.close();
+
+  PackedBits packed = packBitString(bitString);
+  if (!savePackedBits(outputPath, packed)) {
+    cerr << "Failed to write " << outputPath << endl;
+    return false;
+  }
+  cout << inputPath << " -> " << outputPath << ": " << packed.bitCount
+       << " bits, " << bitString.size() << " -> " << packed.bytes.size() + 8
+       << " bytes" << endl;
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  // 用法: Convert.o [旧文件 新文件]...，不带参数时转换仓库自带的三个结果文件
+  if (argc > 1 && argc % 2 == 0) {
+    cerr << "Usage: " << argv[0] << " [legacy.txt output.bin]..." << endl;
+    return 1;
+  }
+
+  bool ok = true;
+  if (argc == 1) {
+    ok &= convertLegacyFile("HuffmanEncodedText.txt", "HuffmanEncodedText.bin");
+    ok &= convertLegacyFile("LZ78EncodedText.txt", "LZ78EncodedText.bin");
+    ok &= convertLegacyFile("ArithmeticEncodedText.txt",
+                            "ArithmeticEncodedText.bin");
+  }
+  for (int i = 1; i + 1 < argc; i += 2) {
+    ok &= convertLegacyFile(argv[i], argv[i + 1]);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 按段读取输入。普通文件用mmap映射，每取下一段前用madvise通知内核丢弃已处理的页，
+// 常驻内存只有当前一段；管道、终端等不能映射的输入用read读入固定大小的缓冲区
+class InputFile {
+public:
+  InputFile(int fd, size_t chunkSize) : fd(fd), chunkSize(chunkSize) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+      regular = true;
+      fileSize = st.st_size;
+    }
+    if (regular && fileSize > 0) {
+      void *p = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        mapped = (const char *)p;
+        mappedSize = fileSize;
+        madvise(p, mappedSize, MADV_SEQUENTIAL);
+        return;
+      }
+    }
+    // 空文件不能映射，与管道一样按read处理，直接读到文件结束
+    buffer.resize(chunkSize);
+  }
+
+  ~InputFile() {
+    if (mapped)
+      munmap((void *)mapped, mappedSize);
+  }
+
+  InputFile(const InputFile &) = delete;
+  InputFile &operator=(const InputFile &) = delete;
+
+  // 普通文件在打开时就知道总长度，管道等返回false
+  bool knownSize(uint64_t &size) const {
+    size = fileSize;
+    return regular;
+  }
+
+  // 取下一段数据，输入结束时size为0；读取失败返回false。
+  // 返回的数据在下一次调用前有效
+  bool next(const char *&data, size_t &size) {
+    if (mapped) {
+      release(offset);
+      size = std::min(chunkSize, mappedSize - offset);
+      data = mapped + offset;
+      offset += size;
+      return true;
+    }
+    while (true) {
+      ssize_t n = read(fd, buffer.data(), buffer.size());
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        return false;
+      data = buffer.data();
+      size = n;
+      return true;
+    }
+  }
+
+private:
+  // 丢弃[released, end)中完整的页，读过的文件页不再占用内存
+  void release(size_t end) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    end = end / page * page;
+    if (end > released) {
+      madvise((void *)(mapped + released), end - released, MADV_DONTNEED);
+      released = end;
+    }
+  }
+
+  int fd;
+  size_t chunkSize;
+  bool regular = false;
+  uint64_t fileSize = 0;
+  const char *mapped = nullptr;
+  size_t mappedSize = 0;
+  size_t offset = 0;   // 下一段在映射中的起始位置
+  size_t released = 0; // 已经丢弃的页的结束位置
+  std::vector<char> buffer;
+};
+
+// 把size个字节全部写入fd，失败返回false
+inline bool writeAll(int fd, const void *data, size_t size) {
+  const char *p = (const char *)data;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
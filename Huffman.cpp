@@ -1,65 +1,43 @@
+#include <bitset>
+#include <ctime>
 #include <fstream>
 #include <iostream>
 #include <math.h>
-#include <queue>
-#include <unordered_map>
 #include <vector>
 
-using namespace std;
-
-// 定义霍夫曼树节点结构体
-struct Node {
-  char ch;            // 字符
-  int freq;           // 频率
-  Node *left, *right; // 左右子节点指针
-};
+#include "BitIO.h"
+#include "BlockFrame.h"
+#include "ByteModel.h"
+#include "Huffman.h"
 
-// 比较函数，用于优先队列，按频率降序排列
-struct compare {
-  bool operator()(Node *l, Node *r) { return l->freq > r->freq; }
-};
+using namespace std;
 
 double culculateTime(clock_t start, clock_t end) {
   // 返回以ms计算的时间
   return (double)((end - start) * 1000) / CLOCKS_PER_SEC;
 }
 
-// 递归打印霍夫曼编码
-void printCodes(Node *root, string str,
-                unordered_map<char, string> &huffmanCode) {
-  if (!root)
-    return; // 如果节点为空，返回
-  if (!root->left && !root->right) {
-    huffmanCode[root->ch] = str; // 如果是叶子节点，存储字符对应的霍夫曼编码
-  }
-  printCodes(root->left, str + "0", huffmanCode);  // 递归遍历左子树，编码加'0'
-  printCodes(root->right, str + "1", huffmanCode); // 递归遍历右子树，编码加'1'
-}
-
-
-string encode(string text, unordered_map<char, string> &huffmanCode) {
-  string encodedText = ""; // 初始化编码后的字符串
-  for (char ch : text) {
-    encodedText += huffmanCode[ch]; // 将每个字符替换为其霍夫曼编码
-  }
-  return encodedText;
-}
-
-string decode(Node *root, string encodedText) {
-  string decodedText = ""; // 初始化解码后的字符串
-  Node *curr = root;       // 当前节点指向根节点
-  for (int i = 0; i < encodedText.size(); ++i) {
-    if (encodedText[i] == '0')
-      curr = curr->left; // 如果当前位为'0'，移动到左子节点
-    else
-      curr = curr->right; // 如果当前位为'1'，移动到右子节点
-
-    if (curr->left == nullptr && curr->right == nullptr) {
-      decodedText += curr->ch; // 如果到达叶子节点，添加字符到解码字符串
-      curr = root;             // 重置当前节点为根节点
-    }
+// 构造码长过满（256个1位码字）和超过上限的码表头，解码都应当失败，
+// 而不是按这样的码长写查找表；只有一个码字的损坏块也不能越界读取
+bool rejectsCorruptHeaders() {
+  for (int length : {1, HUFFMAN_MAX_CODE_LENGTH + 1}) {
+    vector<uint8_t> block;
+    BitWriter writer(block);
+    writer.writeBits(HUFFMAN_FOUR_STREAMS, 8);
+    writeCodeLengths(writer, vector<int>(BYTE_SYMBOLS, length));
+    writer.writeBits(0, 32); // 字符总数
+    writer.writeBits(16, 32);
+    writer.flush();
+    block.resize(block.size() + 64, 0xFF);
+    char out[16];
+    if (huffmanDecodeBlock(block.data(), block.size(), out, sizeof(out)))
+      return false;
   }
-  return decodedText;
+  // 只有字节'a'一个1位码字，之后全是1位，每次都查到表的另一半
+  vector<uint8_t> single = {0x00, 0x61, 0x61, 0x80};
+  single.resize(25, 0xFF);
+  char out[16];
+  return !huffmanDecodeBlock(single.data(), single.size(), out, sizeof(out));
 }
 
 int main() {
@@ -72,67 +50,50 @@ int main() {
   string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
   file.close();
 
-  unordered_map<char, int> frequency; // 存储字符频率的哈希表
-
-  // 计算每个字符的频率
-  for (char ch : text) {
-    frequency[ch]++;
-  }
-
-  // 创建优先队列，按频率升序排列
-  priority_queue<Node *, vector<Node *>, compare> heap;
-
-  // 将所有字符作为单独节点插入优先队列
-  for (auto pair : frequency) {
-    heap.push(new Node({pair.first, pair.second, nullptr, nullptr}));
-  }
+  // 计算每个字节的频率
+  vector<uint64_t> freqs = countByteFrequencies(text);
 
   clock_t start = clock();
-  // 构建霍夫曼树
-  while (heap.size() != 1) {
-    Node *left = heap.top();
-    heap.pop();
-    Node *right = heap.top();
-    heap.pop();
-
-    int sum = left->freq + right->freq;
-    heap.push(new Node({'\0', sum, left, right})); // 合并两个频率最小的节点
-  }
-
-  // 获取每个字符的霍夫曼编码
-  Node *root = heap.top(); // 根节点指向霍夫曼树的根
-  unordered_map<char, string> huffmanCode;
-  printCodes(root, "", huffmanCode);
+  // 构建霍夫曼树，得到码长并生成范式霍夫曼码
+  vector<int> codeLengths = buildCodeLengths(freqs);
+  vector<HuffmanCode> huffmanCode = buildCanonicalCodes(codeLengths);
   clock_t end = clock();
 
   // 编码
-  string encodedText = encode(text, huffmanCode);
+  PackedBits encodedText = encode(text, codeLengths, huffmanCode);
+
+  // 4路码流格式
+  PackedBits encodedStreams =
+      encode(text, codeLengths, huffmanCode, HUFFMAN_FOUR_STREAMS);
 
   // 解码
-  string decodedText = decode(root, encodedText);
+  string decodedText = decode(encodedText);
 
   // 检查解码是否正确
-  if (text == decodedText) {
+  if (text == decodedText && text == decode(encodedStreams)) {
     cout << "Decoded successfully!" << endl;
   } else {
     cout << "Decoding failed!" << endl;
   }
+  if (rejectsCorruptHeaders()) {
+    cout << "Corrupt headers rejected." << endl;
+  } else {
+    cout << "Corrupt header check failed!" << endl;
+  }
 
   // 计算信源的熵
-  double entropy = 0.0;
-  int totalChars = text.size();
-  for (auto pair : frequency) {
-    double prob = (double)pair.second / totalChars; // 计算概率
-    entropy -= prob * log2(prob);                   // 计算熵
-  }
+  double entropy = orderZeroEntropy(freqs);
+  size_t totalChars = text.size();
 
   // 计算平均长度
-  double avgLength = encodedText.size() / (double)totalChars;
+  double avgLength = encodedText.bitCount / (double)totalChars;
 
   cout << "Entropy: " << entropy << endl;          // 输出信源熵
   cout << "Average Length: " << avgLength << endl; // 输出平均长度
   cout << "Compression Ratio: " << (entropy / avgLength) * 100 << "%"
        << endl; // 输出编码效率
+  cout << "Compressed Size: " << encodedText.bytes.size() << " / "
+       << text.size() << " bytes" << endl; // 输出压缩前后的字节数
 
   // 统计构建霍夫曼树的时间开销
   cout << "Huffman Tree Construction Time: "
@@ -141,7 +102,7 @@ int main() {
   // 统计编码时间开销
   start = clock();
   for (int i = 0; i < 100; i++) {
-    string encodedText = encode(text, huffmanCode);
+    PackedBits encodedText = encode(text, codeLengths, huffmanCode);
   }
   end = clock();
   cout << "Encoding Time: " << culculateTime(start, end) / 100.0 << " ms"
@@ -150,20 +111,26 @@ int main() {
   // 统计解码时间开销
   start = clock();
   for (int i = 0; i < 100; i++) {
-    string decodedText = decode(root, encodedText);
+    string decodedText = decode(encodedText);
   }
   end = clock();
   cout << "Decoding Time: " << culculateTime(start, end) / 100.0 << " ms"
        << endl;
 
+  // 统计4路码流的解码时间开销
+  start = clock();
+  for (int i = 0; i < 100; i++) {
+    string decodedText = decode(encodedStreams);
+  }
+  end = clock();
+  cout << "Decoding Time (4 streams): " << culculateTime(start, end) / 100.0
+       << " ms" << endl;
+
   // 输出霍夫曼编码结果到文件
-  ofstream encodedFile("encodedText.txt");
-  if (!encodedFile.is_open()) {
+  if (!savePackedBits("encodedText.bin", encodedText)) {
     cerr << "Failed to open encoded file." << endl;
     return 1;
   }
-  encodedFile << encodedText << endl;
-  encodedFile.close();
 
   // 输出霍夫曼编码表到文件
   ofstream huffmanCodeFile("huffmanCode.txt");
@@ -171,10 +138,19 @@ int main() {
     cerr << "Failed to open huffman code file." << endl;
     return 1;
   }
-  for (const auto &pair : huffmanCode) {
-    huffmanCodeFile << pair.first << " -> " << pair.second << endl;
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    const HuffmanCode &code = huffmanCode[s];
+    if (code.length == 0)
+      continue;
+    huffmanCodeFile << (char)s << " -> "
+                    << bitset<32>(code.bits).to_string().substr(32 - code.length)
+                    << endl;
   }
   huffmanCodeFile.close();
 
+  // 分块并行压缩
+  reportBlockFrame(text, DEFAULT_BLOCK_SIZE, huffmanEncodeBlock,
+                   huffmanDecodeBlock);
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,602 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BitIO.h"
+#include "BlockFrame.h"
+#include "ByteModel.h"
+
+// 霍夫曼编解码：码长构建、范式码表、单路/4路码流和查表解码。
+// Huffman.cpp的测试程序和命令行工具共用这些函数
+
+// 霍夫曼码字，bits的低length位为编码（高位在前）
+struct HuffmanCode {
+  uint32_t bits;
+  int length;
+};
+
+// 码长上限，可在1~16之间配置；码长在码表头中用4位保存
+const int HUFFMAN_MAX_CODE_LENGTH = 15;
+
+// 码长超过maxLength时，用package-merge算法重新求出受限条件下的最优码长
+inline void limitCodeLengths(const uint64_t *freqs, int *codeLengths,
+                             int maxLength) {
+  if (*std::max_element(codeLengths, codeLengths + BYTE_SYMBOLS) <= maxLength)
+    return;
+
+  // 按频率升序排列所有出现过的字符
+  std::vector<int> symbols;
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    if (codeLengths[s] > 0)
+      symbols.push_back(s);
+  }
+  std::stable_sort(symbols.begin(), symbols.end(),
+                   [&](int a, int b) { return freqs[a] < freqs[b]; });
+  int n = symbols.size();
+  while ((1 << maxLength) < n)
+    maxLength++;
+
+  // child < 0 表示叶子（第 -child-1 个字符），否则为上一层的两个子项下标
+  struct Item {
+    uint64_t weight;
+    int left, right;
+  };
+  std::vector<Item> leaves;
+  for (int i = 0; i < n; i++) {
+    leaves.push_back({freqs[symbols[i]], -i - 1, 0});
+  }
+  size_t keep = 2 * n - 2; // 每层最多只需要前2n-2项
+  std::vector<std::vector<Item>> levels(maxLength);
+  levels[0] = leaves;
+  for (int l = 1; l < maxLength; l++) {
+    const std::vector<Item> &prev = levels[l - 1];
+    std::vector<Item> &curr = levels[l];
+    size_t i = 0, j = 0;
+    while (curr.size() < keep && (i < leaves.size() || j + 1 < prev.size())) {
+      bool takeLeaf =
+          j + 1 >= prev.size() ||
+          (i < leaves.size() &&
+           leaves[i].weight <= prev[j].weight + prev[j + 1].weight);
+      if (takeLeaf) {
+        curr.push_back(leaves[i++]);
+      } else {
+        curr.push_back(
+            {prev[j].weight + prev[j + 1].weight, (int)j, (int)j + 1});
+        j += 2;
+      }
+    }
+  }
+
+  // 每个字符的码长等于它在选中项中出现的次数
+  std::fill(codeLengths, codeLengths + BYTE_SYMBOLS, 0);
+  std::vector<std::pair<int, int>> stack; // (层, 下标)
+  for (size_t k = 0; k < keep; k++)
+    stack.push_back({maxLength - 1, (int)k});
+  while (!stack.empty()) {
+    auto [level, index] = stack.back();
+    stack.pop_back();
+    const Item &item = levels[level][index];
+    if (item.left < 0) {
+      codeLengths[symbols[-item.left - 1]]++;
+    } else {
+      stack.push_back({level - 1, item.left});
+      stack.push_back({level - 1, item.right});
+    }
+  }
+}
+
+// 霍夫曼树构建器。节点放在固定的2×256项数组中，用下标表示父节点；
+// 叶子按频率排序后用两个队列在线性时间内建树：一个队列是排好序的叶子，
+// 另一个是依次合并出的内部节点，后合并的频率不小于先合并的，天然有序。
+// 构建器可以反复使用，建树和求码长都不分配堆内存
+class HuffmanTreeBuilder {
+public:
+  // 由字节频率求出码长，写入codeLengths[0, 256)，并限制最大码长
+  void build(const uint64_t *freqs, int *codeLengths,
+             int maxLength = HUFFMAN_MAX_CODE_LENGTH) {
+    int n = 0;
+    for (int s = 0; s < BYTE_SYMBOLS; s++) {
+      codeLengths[s] = 0;
+      if (freqs[s] > 0)
+        symbols[n++] = (uint8_t)s;
+    }
+    if (n == 0)
+      return;
+    if (n == 1) {
+      // 只有一个字符时仍然给它分配1位的码字
+      codeLengths[symbols[0]] = 1;
+      return;
+    }
+
+    // 叶子按频率升序排列，频率相同时按字节值
+    std::sort(symbols, symbols + n, [&](uint8_t a, uint8_t b) {
+      return freqs[a] < freqs[b] || (freqs[a] == freqs[b] && a < b);
+    });
+    for (int i = 0; i < n; i++)
+      weights[i] = freqs[symbols[i]];
+
+    // 节点0~n-1为叶子，n~2n-2为依次合并出的内部节点，最后一个是根
+    int leaf = 0, internal = n;
+    for (int next = n; next < 2 * n - 1; next++) {
+      int left = takeSmaller(leaf, internal, n, next);
+      int right = takeSmaller(leaf, internal, n, next);
+      weights[next] = weights[left] + weights[right];
+      parents[left] = parents[right] = next;
+    }
+
+    // 父节点的下标总是大于子节点，从根往下一次遍历就得到所有深度
+    depths[2 * n - 2] = 0;
+    for (int node = 2 * n - 3; node >= 0; node--)
+      depths[node] = depths[parents[node]] + 1;
+    int longest = 0;
+    for (int i = 0; i < n; i++) {
+      codeLengths[symbols[i]] = depths[i];
+      longest = std::max(longest, depths[i]);
+    }
+    if (longest > maxLength)
+      limitCodeLengths(freqs, codeLengths, maxLength);
+  }
+
+private:
+  // 取出两个队列队首中频率较小的节点，相同时先取叶子，使码长更平均
+  int takeSmaller(int &leaf, int &internal, int leafEnd, int internalEnd) {
+    if (internal >= internalEnd ||
+        (leaf < leafEnd && weights[leaf] <= weights[internal]))
+      return leaf++;
+    return internal++;
+  }
+
+  uint8_t symbols[BYTE_SYMBOLS];      // 第i个叶子对应的字节值
+  uint64_t weights[2 * BYTE_SYMBOLS]; // 节点的频率
+  int parents[2 * BYTE_SYMBOLS];      // 父节点下标
+  int depths[2 * BYTE_SYMBOLS];       // 节点深度，即叶子的码长
+};
+
+// 由字节频率构建霍夫曼树，求出码长并限制最大码长
+inline std::vector<int> buildCodeLengths(const std::vector<uint64_t> &freqs) {
+  std::vector<int> codeLengths(BYTE_SYMBOLS, 0);
+  HuffmanTreeBuilder builder;
+  builder.build(freqs.data(), codeLengths.data());
+  return codeLengths;
+}
+
+// 由码长生成范式霍夫曼码：码长相同的字符按字节值顺序连续编号
+inline std::vector<HuffmanCode>
+buildCanonicalCodes(const std::vector<int> &codeLengths) {
+  int lengthCount[33] = {0};
+  for (int s = 0; s < BYTE_SYMBOLS; s++)
+    lengthCount[codeLengths[s]]++;
+  lengthCount[0] = 0;
+
+  uint32_t nextCode[33] = {0};
+  uint32_t code = 0;
+  for (int len = 1; len <= 32; len++) {
+    code = (code + lengthCount[len - 1]) << 1;
+    nextCode[len] = code;
+  }
+
+  std::vector<HuffmanCode> huffmanCode(BYTE_SYMBOLS, HuffmanCode{0, 0});
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    int len = codeLengths[s];
+    if (len > 0)
+      huffmanCode[s] = {nextCode[len]++, len};
+  }
+  return huffmanCode;
+}
+
+// 码表头：8位最小字节值、8位最大字节值、区间内每个字节1位出现标记，
+// 之后每个出现的字节用4位保存(码长-1)。没有字符时最小值大于最大值
+inline void writeCodeLengths(BitWriter &writer,
+                             const std::vector<int> &codeLengths) {
+  int lo = 0, hi = 255;
+  while (lo < BYTE_SYMBOLS && codeLengths[lo] == 0)
+    lo++;
+  while (hi >= 0 && codeLengths[hi] == 0)
+    hi--;
+  if (lo > hi) {
+    writer.writeBits(1, 8);
+    writer.writeBits(0, 8);
+    return;
+  }
+  writer.writeBits(lo, 8);
+  writer.writeBits(hi, 8);
+  for (int s = lo; s <= hi; s++)
+    writer.writeBit(codeLengths[s] > 0);
+  for (int s = lo; s <= hi; s++) {
+    if (codeLengths[s] > 0)
+      writer.writeBits(codeLengths[s] - 1, 4);
+  }
+}
+
+// 码长能否构成解码器接受的前缀码：不超过码长上限，Kraft和恰好为1，
+// 或者只有一个1位的码字。过满的码表会让查找表写越界；不完整的码表留下空洞，
+// 空洞每次只消耗一级表的位数，decodeSymbols按最短码长分配的缓冲区会不够
+inline bool validCodeLengths(const std::vector<int> &codeLengths) {
+  const int L = HUFFMAN_MAX_CODE_LENGTH;
+  uint32_t kraft = 0; // 以2^-L为单位
+  int count = 0;
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    if (codeLengths[s] == 0)
+      continue;
+    if (codeLengths[s] < 0 || codeLengths[s] > L)
+      return false;
+    kraft += 1u << (L - codeLengths[s]);
+    count++;
+  }
+  if (count == 1)
+    return kraft == 1u << (L - 1);
+  return count == 0 || kraft == 1u << L;
+}
+
+// 读出码表头，码长不合法时返回false
+inline bool readCodeLengths(BitReader &reader, std::vector<int> &codeLengths) {
+  codeLengths.assign(BYTE_SYMBOLS, 0);
+  int lo = reader.readBits(8);
+  int hi = reader.readBits(8);
+  for (int s = lo; s <= hi; s++)
+    codeLengths[s] = reader.readBit();
+  for (int s = lo; s <= hi; s++) {
+    if (codeLengths[s] > 0)
+      codeLengths[s] = reader.readBits(4) + 1;
+  }
+  return validCodeLengths(codeLengths);
+}
+
+// 码流格式：单一码流，或把数据等分成4段各自编码、可以交错解码的4路码流
+enum HuffmanStreamFormat {
+  HUFFMAN_SINGLE_STREAM = 0,
+  HUFFMAN_FOUR_STREAMS = 1,
+};
+const int HUFFMAN_STREAMS = 4;
+
+inline void encodeSymbols(BitWriter &writer, const char *text, size_t length,
+                          const std::vector<HuffmanCode> &huffmanCode) {
+  for (size_t i = 0; i < length; i++) {
+    const HuffmanCode &code = huffmanCode[(unsigned char)text[i]];
+    writer.writeBits(code.bits, code.length); // 将每个字符替换为其霍夫曼编码
+  }
+}
+
+// 编码结果由8位格式标记、码表头和码字组成，解码端不需要额外的信息。
+// 4路格式在码表头之后保存64位字符总数，补齐到整字节后是跳转表
+// （前3路码流的字节数，各4字节小端序），随后依次是4路按字节对齐的码流。
+// 结果追加到out之后，返回写入的比特数
+inline uint64_t encodeInto(std::vector<uint8_t> &out, const char *text,
+                           size_t length, const std::vector<int> &codeLengths,
+                           const std::vector<HuffmanCode> &huffmanCode,
+                           HuffmanStreamFormat format) {
+  size_t start = out.size();
+  BitWriter writer(out);
+  writer.writeBits(format, 8);
+  writeCodeLengths(writer, codeLengths);
+  if (format == HUFFMAN_SINGLE_STREAM) {
+    encodeSymbols(writer, text, length, huffmanCode);
+    return writer.flush();
+  }
+
+  uint64_t total = length;
+  writer.writeBits(total >> 32, 32);
+  writer.writeBits(total & 0xFFFFFFFF, 32);
+  writer.flush();
+
+  size_t jumpTable = out.size();
+  out.resize(jumpTable + 4 * (HUFFMAN_STREAMS - 1));
+  size_t segment = (total + HUFFMAN_STREAMS - 1) / HUFFMAN_STREAMS;
+  for (int k = 0; k < HUFFMAN_STREAMS; k++) {
+    size_t begin = std::min(total, k * segment);
+    size_t end = std::min(total, begin + segment);
+    size_t streamStart = out.size();
+    BitWriter streamWriter(out);
+    encodeSymbols(streamWriter, text + begin, end - begin, huffmanCode);
+    streamWriter.flush();
+    if (k < HUFFMAN_STREAMS - 1)
+      putLE32(out, jumpTable + 4 * k, out.size() - streamStart);
+  }
+  return (out.size() - start) * 8;
+}
+
+inline PackedBits encode(const std::string &text,
+                         const std::vector<int> &codeLengths,
+                         const std::vector<HuffmanCode> &huffmanCode,
+                         HuffmanStreamFormat format = HUFFMAN_SINGLE_STREAM) {
+  PackedBits encoded; // 初始化编码后的比特流
+  encoded.bytes.reserve(text.size());
+  encoded.bitCount = encodeInto(encoded.bytes, text.data(), text.size(),
+                                codeLengths, huffmanCode, format);
+  return encoded;
+}
+
+// 一级查找表的索引位数，2^11个表项常驻L1缓存
+const int HUFFMAN_TABLE_BITS = 11;
+
+// 查找表表项：一次查表解出一个或两个符号；count为0时指向二级表
+struct HuffmanDecodeEntry {
+  uint32_t subtable;   // 二级表在entries中的起始位置
+  uint8_t symbols[2];  // 解出的符号
+  uint8_t count;       // 解出的符号数，0表示需要查二级表
+  uint8_t length;      // 消耗的总比特数；二级表入口处为二级表索引位数
+  uint8_t firstLength; // 第一个符号的码长
+};
+
+struct HuffmanDecodeTable {
+  std::vector<HuffmanDecodeEntry> entries; // 一级表在前，二级表依次在后
+  int maxLength = 0;                       // 最长码长
+  int minLength = 0;                       // 最短码长
+};
+
+// 根据每个符号的码字构建多比特查找表
+inline HuffmanDecodeTable
+buildDecodeTable(const std::vector<HuffmanCode> &huffmanCode) {
+  const int N = HUFFMAN_TABLE_BITS;
+  const uint32_t mask = (1u << N) - 1;
+  HuffmanDecodeTable table;
+  table.entries.assign(1u << N, HuffmanDecodeEntry{0, {0, 0}, 0, 0, 0});
+  table.minLength = 32;
+
+  // 短码：填充以该码字为前缀的所有一级表项
+  std::vector<int> subtableBits(1u << N, 0); // 长码前缀 -> 二级表位数
+  int symbolCount = 0;
+  int lastSymbol = 0;
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    const HuffmanCode &code = huffmanCode[s];
+    if (code.length == 0)
+      continue;
+    symbolCount++;
+    lastSymbol = s;
+    table.maxLength = std::max(table.maxLength, code.length);
+    table.minLength = std::min(table.minLength, code.length);
+    if (code.length > N) {
+      uint32_t prefix = code.bits >> (code.length - N);
+      subtableBits[prefix] = std::max(subtableBits[prefix], code.length - N);
+      continue;
+    }
+    uint32_t first = code.bits << (N - code.length);
+    uint32_t last = first + (1u << (N - code.length));
+    for (uint32_t i = first; i < last; i++) {
+      table.entries[i] = {0, {(uint8_t)s, 0}, 1,
+                          (uint8_t)code.length, (uint8_t)code.length};
+    }
+  }
+
+  // 只有一个1位码字"0"时，"1"开头的一半表项仍为空，解码时会被当作
+  // 指向二级表的表项。让它们同样以1位解出这个符号，损坏的码流也只会多解出字符
+  if (symbolCount == 1) {
+    for (uint32_t i = 0; i <= mask; i++)
+      table.entries[i] = {0, {(uint8_t)lastSymbol, 0}, 1, 1, 1};
+  }
+
+  // 长码：为每个长码前缀分配二级表
+  for (uint32_t prefix = 0; prefix <= mask; prefix++) {
+    if (subtableBits[prefix] == 0)
+      continue;
+    HuffmanDecodeEntry &entry = table.entries[prefix];
+    entry.subtable = table.entries.size();
+    entry.count = 0;
+    entry.length = subtableBits[prefix];
+    table.entries.resize(table.entries.size() + (1u << subtableBits[prefix]));
+  }
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    const HuffmanCode &code = huffmanCode[s];
+    if (code.length <= N)
+      continue;
+    const HuffmanDecodeEntry &root =
+        table.entries[code.bits >> (code.length - N)];
+    int rest = code.length - N;
+    uint32_t first = (code.bits & ((1u << rest) - 1)) << (root.length - rest);
+    uint32_t last = first + (1u << (root.length - rest));
+    for (uint32_t i = first; i < last; i++) {
+      table.entries[root.subtable + i] = {0, {(uint8_t)s, 0}, 1,
+                                          (uint8_t)rest, (uint8_t)rest};
+    }
+  }
+
+  // 若剩余的比特足以确定下一个符号，则把两个符号合并进同一表项
+  std::vector<HuffmanDecodeEntry> single(table.entries.begin(),
+                                         table.entries.begin() + (1u << N));
+  for (uint32_t i = 0; i <= mask; i++) {
+    const HuffmanDecodeEntry &a = single[i];
+    if (a.count != 1)
+      continue;
+    const HuffmanDecodeEntry &b = single[(i << a.length) & mask];
+    if (b.count == 1 && a.length + b.length <= N) {
+      table.entries[i].symbols[1] = b.symbols[0];
+      table.entries[i].count = 2;
+      table.entries[i].length = a.length + b.length;
+    }
+  }
+  return table;
+}
+
+// 查一次表，解出一个或两个符号；调用方需保证out之后至少还有两个字节
+inline void decodeStep(const HuffmanDecodeEntry *entries, BitReader &reader,
+                       char *&out) {
+  const int N = HUFFMAN_TABLE_BITS;
+  const HuffmanDecodeEntry &entry = entries[reader.peekBits(N)];
+  if (entry.count == 0) {
+    reader.skipBits(N);
+    const HuffmanDecodeEntry &sub =
+        entries[entry.subtable + reader.peekBits(entry.length)];
+    reader.skipBits(sub.length);
+    *out++ = sub.symbols[0];
+    return;
+  }
+  reader.skipBits(entry.length);
+  out[0] = entry.symbols[0];
+  out[1] = entry.symbols[1];
+  out += entry.count;
+}
+
+// 只解出一个符号
+inline void decodeOne(const HuffmanDecodeEntry *entries, BitReader &reader,
+                      char *&out) {
+  const int N = HUFFMAN_TABLE_BITS;
+  const HuffmanDecodeEntry &entry = entries[reader.peekBits(N)];
+  if (entry.count == 0) {
+    reader.skipBits(N);
+    const HuffmanDecodeEntry &sub =
+        entries[entry.subtable + reader.peekBits(entry.length)];
+    reader.skipBits(sub.length);
+    *out++ = sub.symbols[0];
+    return;
+  }
+  reader.skipBits(entry.firstLength);
+  *out++ = entry.symbols[0];
+}
+
+// 从reader的当前位置解码到第bitCount位
+inline std::string decodeSymbols(const HuffmanDecodeTable &table,
+                                 BitReader &reader, uint64_t bitCount) {
+  const int N = HUFFMAN_TABLE_BITS;
+  const HuffmanDecodeEntry *entries = table.entries.data();
+  if (table.maxLength == 0)
+    return "";
+
+  // 预先分配输出缓冲区：符号数不超过 比特数/最短码长，多留一个字节供双符号写入
+  std::string decodedText((bitCount - reader.position()) / table.minLength + 2,
+                          '\0');
+  char *out = &decodedText[0];
+
+  // 快速路径：剩余比特足够时，每次查表不需要检查边界
+  uint64_t safeEnd = bitCount >= (uint64_t)std::max(N, table.maxLength)
+                         ? bitCount - std::max(N, table.maxLength)
+                         : 0;
+  while (reader.position() < safeEnd) {
+    decodeStep(entries, reader, out);
+  }
+
+  // 尾部：逐个符号解码，不能越过有效比特数
+  while (reader.position() < bitCount) {
+    uint64_t remaining = bitCount - reader.position();
+    const HuffmanDecodeEntry &entry = entries[reader.peekBits(N)];
+    if (entry.count == 0) {
+      uint32_t subIndex =
+          reader.peekBits(N + entry.length) & ((1u << entry.length) - 1);
+      const HuffmanDecodeEntry &sub = entries[entry.subtable + subIndex];
+      if ((uint64_t)(N + sub.length) > remaining)
+        break;
+      reader.skipBits(N + sub.length);
+      *out++ = sub.symbols[0];
+      continue;
+    }
+    if (entry.firstLength > remaining)
+      break;
+    reader.skipBits(entry.firstLength);
+    *out++ = entry.symbols[0];
+  }
+
+  decodedText.resize(out - decodedText.data());
+  return decodedText;
+}
+
+// 4路码流交错解码：每路的字符数已知，4个读取器互不依赖，
+// 循环体内的4次查表可以并行执行。字符总数在分配输出之前检查：超过maxTotal，
+// 或超过码流的比特数（每个字符至少1位）时视为损坏，与跳转表越界一样返回空串
+inline std::string decodeFourStreams(const HuffmanDecodeTable &table,
+                                     BitReader &reader, const uint8_t *data,
+                                     size_t size, uint64_t maxTotal) {
+  uint64_t total = (uint64_t)reader.readBits(32) << 32;
+  total |= reader.readBits(32);
+  size_t jumpTable = (reader.position() + 7) / 8;
+  size_t segment = (total + HUFFMAN_STREAMS - 1) / HUFFMAN_STREAMS;
+  if (jumpTable + 4 * (HUFFMAN_STREAMS - 1) > size || total > maxTotal ||
+      total > (uint64_t)size * 8)
+    return "";
+
+  // 由跳转表得到每路码流的位置
+  size_t streamStart[HUFFMAN_STREAMS + 1];
+  streamStart[0] = jumpTable + 4 * (HUFFMAN_STREAMS - 1);
+  for (int k = 0; k < HUFFMAN_STREAMS - 1; k++) {
+    streamStart[k + 1] =
+        std::min(streamStart[k] + getLE32(data + jumpTable + 4 * k), size);
+  }
+  streamStart[HUFFMAN_STREAMS] = size;
+
+  std::string decodedText(total, '\0');
+  if (total == 0)
+    return decodedText;
+  BitReader r0(data + streamStart[0], streamStart[1] - streamStart[0]);
+  BitReader r1(data + streamStart[1], streamStart[2] - streamStart[1]);
+  BitReader r2(data + streamStart[2], streamStart[3] - streamStart[2]);
+  BitReader r3(data + streamStart[3], streamStart[4] - streamStart[3]);
+  char *base = &decodedText[0];
+  char *out0 = base, *end0 = base + std::min(total, segment);
+  char *out1 = end0, *end1 = base + std::min(total, 2 * segment);
+  char *out2 = end1, *end2 = base + std::min(total, 3 * segment);
+  char *out3 = end2, *end3 = base + total;
+
+  // 每路至少还剩两个字符时，双符号表项不会写出本段或解出填充位
+  const HuffmanDecodeEntry *entries = table.entries.data();
+  while (end0 - out0 >= 2 && end1 - out1 >= 2 && end2 - out2 >= 2 &&
+         end3 - out3 >= 2) {
+    decodeStep(entries, r0, out0);
+    decodeStep(entries, r1, out1);
+    decodeStep(entries, r2, out2);
+    decodeStep(entries, r3, out3);
+  }
+
+  // 尾部：各路逐个符号解码剩下的字符
+  while (out0 < end0)
+    decodeOne(entries, r0, out0);
+  while (out1 < end1)
+    decodeOne(entries, r1, out1);
+  while (out2 < end2)
+    decodeOne(entries, r2, out2);
+  while (out3 < end3)
+    decodeOne(entries, r3, out3);
+  return decodedText;
+}
+
+// 先读出格式标记和码表头，重建范式码和查找表，再解码码字。
+// 格式标记未知或码表头不合法时返回false；4路格式的字符总数超过maxLength时
+// 解出空串
+inline bool decode(const uint8_t *data, size_t size, uint64_t bitCount,
+                   std::string &decodedText, uint64_t maxLength = UINT64_MAX) {
+  BitReader reader(data, size);
+  int format = reader.readBits(8);
+  if (format != HUFFMAN_SINGLE_STREAM && format != HUFFMAN_FOUR_STREAMS)
+    return false;
+  std::vector<int> codeLengths;
+  if (!readCodeLengths(reader, codeLengths))
+    return false;
+  HuffmanDecodeTable table = buildDecodeTable(buildCanonicalCodes(codeLengths));
+  if (format == HUFFMAN_FOUR_STREAMS)
+    decodedText = decodeFourStreams(table, reader, data, size, maxLength);
+  else
+    decodedText = decodeSymbols(table, reader, bitCount);
+  return true;
+}
+
+// 解码失败时返回空串
+inline std::string decode(const PackedBits &encoded) {
+  std::string decodedText;
+  decode(encoded.bytes.data(), encoded.bytes.size(), encoded.bitCount,
+         decodedText);
+  return decodedText;
+}
+
+// 分块压缩：每块独立统计频率、建立码表，使用4路码流格式
+inline void huffmanEncodeBlock(const char *data, size_t size,
+                               std::vector<uint8_t> &out) {
+  std::vector<uint64_t> freqs(BYTE_SYMBOLS, 0);
+  countByteFrequencies((const uint8_t *)data, size, freqs.data());
+  std::vector<int> codeLengths = buildCodeLengths(freqs);
+  std::vector<HuffmanCode> huffmanCode = buildCanonicalCodes(codeLengths);
+  encodeInto(out, data, size, codeLengths, huffmanCode, HUFFMAN_FOUR_STREAMS);
+}
+
+// huffmanEncodeBlock只写出4路格式，其他格式标记都是损坏的数据；
+// 否则单路解码会把跳转表和各路码流当作一整段码字
+inline bool huffmanDecodeBlock(const uint8_t *data, size_t size, char *out,
+                               size_t originalSize) {
+  if (size == 0 || data[0] != HUFFMAN_FOUR_STREAMS)
+    return false;
+  std::string decodedText;
+  if (!decode(data, size, size * 8, decodedText, originalSize) ||
+      decodedText.size() != originalSize)
+    return false;
+  std::copy(decodedText.begin(), decodedText.end(), out);
+  return true;
+}
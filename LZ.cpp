@@ -1,146 +1,77 @@
+#include <algorithm>
 #include <bitset>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-using namespace std;
+#include "BitIO.h"
+#include "BlockFrame.h"
+#include "ByteModel.h"
+#include "LZ.h"
 
-unordered_map<char, string> symbolTable;
-unordered_map<string, char> reverseSymbolTable;
-int symbolBits = 0;
-int segBits = 0;
+using namespace std;
 
 double culculateTime(clock_t start, clock_t end) {
   // 返回以ms计算的时间
   return (double)((end - start) * 1000) / CLOCKS_PER_SEC;
 }
 
-void buildSymbolTable(const string &input) {
-  int dictSize = 0;
-  unordered_map<char, int> tempSymbolTable;
-  // 统计所有的字符，得到符号编码表
-  for (char c : input) {
-    if (tempSymbolTable.find(c) ==
-        tempSymbolTable.end()) { // 如果字符不在符号表中
-      tempSymbolTable[c] = dictSize++;
-    }
-  }
-
-  // 计算编码所需的位数
-  dictSize = tempSymbolTable.size();
-  while ((1 << symbolBits) < dictSize) {
-    symbolBits++;
-  }
-
-  // 将int值转换为二进制字符串，存入符号表
-  for (const auto &pair : tempSymbolTable) {
-    string binaryString =
-        bitset<8>(pair.second).to_string().substr(8 - symbolBits);
-    symbolTable[pair.first] = binaryString;
-  }
-}
-
-void buildReverseSymbolTable() {
-  for (const auto &pair : symbolTable) {
-    reverseSymbolTable[pair.second] = pair.first;
-  }
+// 测试一个LZ77级别：检查往返正确，输出压缩后大小和编解码速度(MB/s)
+bool reportLZ77Level(const string &text, int level) {
+  LZ77Options options;
+  options.level = level;
+  vector<uint8_t> encoded;
+  lz77Encode(text.data(), text.size(), options, encoded);
+  string decoded(text.size(), '\0');
+  bool ok = lz77DecodeInto(encoded.data(), encoded.size(), &decoded[0],
+                           decoded.size()) == (int64_t)text.size() &&
+            decoded == text;
+
+  const int rounds = 10;
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    vector<uint8_t> out;
+    lz77Encode(text.data(), text.size(), options, out);
+  }
+  chrono::duration<double> encodeSeconds = chrono::steady_clock::now() - start;
+  start = chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    lz77DecodeInto(encoded.data(), encoded.size(), &decoded[0],
+                   decoded.size());
+  }
+  chrono::duration<double> decodeSeconds = chrono::steady_clock::now() - start;
+
+  cout << "LZ77 Level " << level << ": " << (ok ? "OK" : "FAILED") << ", "
+       << encoded.size() << " / " << text.size() << " bytes, "
+       << text.size() * rounds / encodeSeconds.count() / 1e6
+       << " MB/s encoding, "
+       << text.size() * rounds / decodeSeconds.count() / 1e6
+       << " MB/s decoding" << endl;
+  return ok;
 }
 
-string lz78Encode(const string &input) {
-  unordered_map<string, int> dictionary;
-  vector<pair<int, string>> encodedData;
-  string encodedBits;
-
-  int dictSize = 1;
-  string currentString = "";
-  // 分段，得到字典，并进行初步编码
-  for (char c : input) {
-    currentString += c;
-    if (dictionary.find(currentString) == dictionary.end()) {
-      // 如果当前字符串不在字典中
-      int index =
-          currentString.length() > 1
-              ? dictionary[currentString.substr(0, currentString.length() - 1)]
-              : 0;
-      char lastChar = currentString.back();
-      string lastCharBits = symbolTable[lastChar];
-      encodedData.push_back(make_pair(index, lastCharBits));
-      dictionary[currentString] = dictSize++;
-      currentString = "";
-    }
-  }
-  // 处理最后一个字符
-  if (!currentString.empty()) {
-    int index =
-        currentString.length() > 1
-            ? dictionary[currentString.substr(0, currentString.length() - 1)]
-            : 0;
-    char lastChar = currentString.back();
-    string lastCharBits = symbolTable[lastChar];
-    encodedData.push_back(make_pair(index, lastCharBits));
-  }
-
-  // 计算段号所需的位数
-  dictSize = dictionary.size();
-  while ((1 << segBits) < dictSize) {
-    segBits++;
-  }
-
-  // 在初步编码的基础上完成编码
-  for (const auto &pair : encodedData) {
-    // 将索引转换为二进制字符串
-    int index = pair.first;
-    string indexBits = bitset<16>(index).to_string().substr(16 - segBits);
-
-    // 拼接编码结果
-    encodedBits += indexBits + pair.second;
-  }
-
-  // 输出字典的内容到文件
-  ofstream dictionaryFile("dictionary.txt");
-  for (const auto &pair : dictionary) {
-    dictionaryFile << pair.first << " -> " << pair.second << endl;
+// 按64KiB分段做一次流式编码和解码，返回是否还原
+bool streamRoundTrip(const string &text, const LZ78StreamOptions &options,
+                     vector<uint8_t> &encoded) {
+  const size_t CHUNK = 64 * 1024;
+  LZ78StreamEncoder encoder(options);
+  encoded.clear();
+  for (size_t i = 0; i < text.size(); i += CHUNK) {
+    encoder.update(text.data() + i, min(CHUNK, text.size() - i), encoded);
   }
-  dictionaryFile.close();
+  encoder.finish(encoded);
 
-  return encodedBits;
-}
-
-string lz78Decode(const string &encodedBits) {
+  LZ78StreamDecoder decoder;
   string decodedText;
-  unordered_map<int, string> dictionary;
-  int dictSize = 1;
-
-  // 解码
-  size_t pos = 0;
-  while (pos < encodedBits.length()) {
-    // 提取出段号
-    if (pos + segBits > encodedBits.length())
-      break;
-    string indexBitSequence = encodedBits.substr(pos, segBits);
-    pos += segBits;
-
-    // 提取出符号
-    if (pos + symbolBits > encodedBits.length())
-      break;
-    string symbolBitSequence = encodedBits.substr(pos, symbolBits);
-    pos += symbolBits;
-
-    // 将索引转换为整数
-    int index = bitset<64>(indexBitSequence).to_ulong();
-
-    // 解码
-    char nextChar = reverseSymbolTable[symbolBitSequence];
-    string decodedString =
-        (index > 0) ? dictionary[index] + nextChar : string(1, nextChar);
-
-    decodedText += decodedString;
-    dictionary[dictSize++] = decodedString;
+  for (size_t i = 0; i < encoded.size(); i += CHUNK) {
+    if (!decoder.update(encoded.data() + i, min(CHUNK, encoded.size() - i),
+                        decodedText))
+      return false;
   }
-
-  return decodedText;
+  return decoder.done() && decodedText == text;
 }
 
 int main() {
@@ -153,14 +84,17 @@ int main() {
   string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
   file.close();
 
-  buildSymbolTable(text);    // 构建符号表
-  buildReverseSymbolTable(); // 构建化反向符号表
+  vector<uint64_t> freqs = countByteFrequencies(text);
+  LZ78Codebook codebook;
+  buildSymbolTable(freqs, codebook); // 构建符号表
+  buildReverseSymbolTable(codebook); // 构建化反向符号表
 
   // 编码
-  string encodedText = lz78Encode(text);
+  PackedBits encodedText =
+      lz78Encode(codebook, text.data(), text.size(), "dictionary.txt");
 
   // 解码
-  string decodedText = lz78Decode(encodedText);
+  string decodedText = lz78Decode(codebook, encodedText);
 
   // 比较编码和解码结果
   if (text == decodedText) {
@@ -170,17 +104,19 @@ int main() {
   }
 
   // 计算编码效率
-  double entropy = 4.42954;
-  double avgLength = encodedText.size() / (double)text.size();
+  double entropy = orderZeroEntropy(freqs);
+  double avgLength = encodedText.bitCount / (double)text.size();
   cout << "Entropy: " << entropy << endl;          // 输出信源熵
   cout << "Average Length: " << avgLength << endl; // 输出平均长度
   cout << "Compression Ratio: " << (entropy / avgLength) * 100 << "%"
        << endl; // 输出编码效率
+  cout << "Compressed Size: " << encodedText.bytes.size() << " / "
+       << text.size() << " bytes" << endl; // 输出压缩前后的字节数
 
   // 统计编码时间消耗
   clock_t start = clock();
   for (int i = 0; i < 100; i++) {
-    lz78Encode(text);
+    lz78Encode(codebook, text);
   }
   clock_t end = clock();
   cout << "Encoding Time: " << culculateTime(start, end) / 100.0 << " ms"
@@ -189,7 +125,7 @@ int main() {
   // 统计解码时间消耗
   start = clock();
   for (int i = 0; i < 100; i++) {
-    lz78Decode(encodedText);
+    lz78Decode(codebook, encodedText);
   }
   end = clock();
   cout << "Decoding Time: " << culculateTime(start, end) / 100.0 << " ms"
@@ -201,18 +137,44 @@ int main() {
     cerr << "Failed to open output file." << endl;
     return 1;
   }
-  for (const auto &pair : symbolTable) {
-    outputFile << pair.first << " -> " << pair.second << endl;
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    if (codebook.symbolTable[s] < 0)
+      continue;
+    outputFile << (char)s << " -> "
+               << bitset<8>(codebook.symbolTable[s])
+                      .to_string()
+                      .substr(8 - codebook.symbolBits)
+               << endl;
   }
   outputFile.close();
 
-  // 输出编码结果到文件 
-  ofstream encodedFile("encodedText.txt");
-  if (!encodedFile.is_open()) {
+  // 输出编码结果到文件
+  if (!savePackedBits("encodedText.bin", encodedText)) {
     cerr << "Failed to open encoded file." << endl;
     return 1;
   }
-  encodedFile << encodedText << endl;
-  encodedFile.close();
+
+  // 流式编码：字典上限取1024段，分别测试清空和冻结两种策略
+  for (LZ78DictionaryPolicy policy : {LZ78_RESET, LZ78_FREEZE}) {
+    LZ78StreamOptions options;
+    options.maxDictionarySize = 1024;
+    options.policy = policy;
+    vector<uint8_t> streamEncoded;
+    bool ok = streamRoundTrip(text, options, streamEncoded);
+    cout << "Streaming (" << (policy == LZ78_RESET ? "reset" : "freeze")
+         << ", " << options.maxDictionarySize << " phrases): "
+         << (ok ? "OK" : "FAILED") << ", " << streamEncoded.size() << " / "
+         << text.size() << " bytes" << endl;
+  }
+
+  // 分块并行压缩
+  reportBlockFrame(text, DEFAULT_BLOCK_SIZE, lz78EncodeBlock, lz78DecodeBlock);
+
+  // LZ77：几个级别的压缩率和速度，分块帧与上面的LZ78直接对比
+  for (int level : {1, 6, 9}) {
+    reportLZ77Level(text, level);
+  }
+  cout << "LZ77 Level " << LZ77Options().level << ":" << endl;
+  reportBlockFrame(text, DEFAULT_BLOCK_SIZE, lz77EncodeBlock, lz77DecodeBlock);
   return 0;
 }
@@ -0,0 +1,801 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BitIO.h"
+#include "ByteModel.h"
+
+// LZ78（静态码表和流式字典）与LZ77（哈希链匹配）编解码。
+// LZ.cpp的测试程序和命令行工具共用这些函数
+
+// LZ78码流的参数：符号表和段号位数。编码端和解码端各自持有一份，
+// 没有全局状态，多个编解码过程可以在不同线程中同时进行
+struct LZ78Codebook {
+  // 字节值 -> 符号编号
+  std::vector<int> symbolTable = std::vector<int>(BYTE_SYMBOLS, -1);
+  std::vector<unsigned char> reverseSymbolTable; // 符号编号 -> 字节值
+  int symbolBits = 0;
+  int segBits = 0;
+};
+
+inline void buildSymbolTable(const std::vector<uint64_t> &freqs,
+                             LZ78Codebook &codebook) {
+  int dictSize = 0;
+  // 按字节值顺序给所有出现过的字符编号，得到符号编码表
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    codebook.symbolTable[s] = freqs[s] > 0 ? dictSize++ : -1;
+  }
+
+  // 计算编码所需的位数，每个符号用symbolBits位编码
+  codebook.symbolBits = 0;
+  while ((1 << codebook.symbolBits) < dictSize) {
+    codebook.symbolBits++;
+  }
+}
+
+inline void buildReverseSymbolTable(LZ78Codebook &codebook) {
+  codebook.reverseSymbolTable.assign(1 << codebook.symbolBits, 0);
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    if (codebook.symbolTable[s] >= 0)
+      codebook.reverseSymbolTable[codebook.symbolTable[s]] = (unsigned char)s;
+  }
+}
+
+// LZ78字典树：节点编号就是字典中的段号，0号节点为根（空串）。
+// 子节点以(父节点, 下一个字节)为键存放在开放寻址哈希表中，键和值放在同一个槽里，
+// 每次探查只访问一处内存。最先建立的HOT_NODES个节点（根和最短的段，
+// 也是被访问最多的节点）另外使用256项的直接索引数组
+class LZ78Trie {
+public:
+  static const int HOT_NODES = 256;
+
+  explicit LZ78Trie(size_t expectedNodes = 1024)
+      : dense((size_t)HOT_NODES * BYTE_SYMBOLS, 0) {
+    size_t capacity = 64;
+    while (capacity < expectedNodes * 2)
+      capacity <<= 1;
+    slots.assign(capacity, Slot{0, 0, 0});
+    parents.push_back(0);
+    lastBytes.push_back(0);
+  }
+
+  size_t size() const { return parents.size(); }
+  int parent(int node) const { return parents[node]; }
+  unsigned char lastByte(int node) const { return lastBytes[node]; }
+
+  // 查找node的字节为byte的子节点；不存在时插入新节点并令inserted为true。
+  // 每次调用只做一次哈希探查（或一次直接索引）
+  int findOrInsert(int node, unsigned char byte, bool &inserted) {
+    if (node < HOT_NODES) {
+      int &child = dense[(size_t)node * BYTE_SYMBOLS + byte];
+      inserted = child == 0;
+      if (inserted)
+        child = addNode(node, byte);
+      return child;
+    }
+
+    size_t mask = slots.size() - 1;
+    size_t i = hashKey(node, byte) & mask;
+    while (slots[i].nodePlusOne != 0) {
+      if (slots[i].nodePlusOne == (uint32_t)node + 1 && slots[i].byte == byte) {
+        inserted = false;
+        return slots[i].child;
+      }
+      i = (i + 1) & mask;
+    }
+    inserted = true;
+    int child = addNode(node, byte);
+    slots[i] = Slot{(uint32_t)node + 1, (uint32_t)child, byte};
+    if (++used * 2 > slots.size())
+      grow();
+    return child;
+  }
+
+  // 只查找不插入，不存在时返回-1
+  int find(int node, unsigned char byte) const {
+    if (node < HOT_NODES) {
+      int child = dense[(size_t)node * BYTE_SYMBOLS + byte];
+      return child == 0 ? -1 : child;
+    }
+    size_t mask = slots.size() - 1;
+    for (size_t i = hashKey(node, byte) & mask; slots[i].nodePlusOne != 0;
+         i = (i + 1) & mask) {
+      if (slots[i].nodePlusOne == (uint32_t)node + 1 && slots[i].byte == byte)
+        return slots[i].child;
+    }
+    return -1;
+  }
+
+  // 清空字典，只保留根节点，不释放已分配的内存
+  void clear() {
+    std::fill(slots.begin(), slots.end(), Slot{0, 0, 0});
+    std::fill(dense.begin(), dense.end(), 0);
+    used = 0;
+    parents.resize(1);
+    lastBytes.resize(1);
+  }
+
+private:
+  // nodePlusOne为0表示空槽
+  struct Slot {
+    uint32_t nodePlusOne;
+    uint32_t child;
+    uint8_t byte;
+  };
+
+  static size_t hashKey(int node, unsigned char byte) {
+    uint64_t key = ((uint64_t)node << 8) | byte;
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 20);
+  }
+
+  int addNode(int node, unsigned char byte) {
+    parents.push_back(node);
+    lastBytes.push_back(byte);
+    return (int)parents.size() - 1;
+  }
+
+  void grow() {
+    std::vector<Slot> oldSlots(slots.size() * 2, Slot{0, 0, 0});
+    oldSlots.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (const Slot &slot : oldSlots) {
+      if (slot.nodePlusOne == 0)
+        continue;
+      size_t i = hashKey(slot.nodePlusOne - 1, slot.byte) & mask;
+      while (slots[i].nodePlusOne != 0)
+        i = (i + 1) & mask;
+      slots[i] = slot;
+    }
+  }
+
+  std::vector<Slot> slots;
+  size_t used = 0;
+  std::vector<int> dense;               // 热点节点的直接索引数组，0表示没有该子节点
+  std::vector<int> parents;             // 父节点
+  std::vector<unsigned char> lastBytes; // 从父节点到本节点的字节
+};
+
+// 段号位数写入codebook.segBits；dictionaryPath不为空时把字典输出到该文件
+inline PackedBits lz78Encode(LZ78Codebook &codebook, const char *input,
+                             size_t length,
+                             const char *dictionaryPath = nullptr) {
+  LZ78Trie dictionary(std::min(length / 4, (size_t)1 << 20) + 1);
+  std::vector<std::pair<int, int>> encodedData;
+  PackedBits encodedBits;
+
+  // 分段，得到字典，并进行初步编码。当前串用字典树节点表示，
+  // 每读入一个字节只需查找一次(当前节点, 字节)
+  int node = 0;
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = input[i];
+    bool inserted;
+    int child = dictionary.findOrInsert(node, c, inserted);
+    if (inserted) {
+      // 如果当前字符串不在字典中，输出(前缀段号, 最后一个字符)
+      encodedData.push_back(std::make_pair(node, codebook.symbolTable[c]));
+      node = 0;
+    } else {
+      node = child;
+    }
+  }
+  // 处理最后一个字符
+  if (node != 0) {
+    encodedData.push_back(
+        std::make_pair(dictionary.parent(node),
+                       codebook.symbolTable[dictionary.lastByte(node)]));
+  }
+
+  // 计算段号所需的位数，段号最大可以等于字典大小
+  int dictSize = dictionary.size() - 1;
+  int &segBits = codebook.segBits;
+  segBits = 0;
+  while ((1 << segBits) <= dictSize) {
+    segBits++;
+  }
+
+  // 在初步编码的基础上完成编码，段号和符号直接写入比特流
+  BitWriter writer(encodedBits.bytes);
+  for (const auto &pair : encodedData) {
+    writer.writeBits(pair.first, segBits);
+    writer.writeBits(pair.second, codebook.symbolBits);
+  }
+  encodedBits.bitCount = writer.flush();
+
+  // 输出字典的内容到文件，由父节点链还原每个段
+  if (dictionaryPath) {
+    std::ofstream dictionaryFile(dictionaryPath);
+    for (int index = 1; index <= dictSize; index++) {
+      std::string phrase;
+      for (int n = index; n != 0; n = dictionary.parent(n))
+        phrase += (char)dictionary.lastByte(n);
+      dictionaryFile << std::string(phrase.rbegin(), phrase.rend()) << " -> "
+                     << index << std::endl;
+    }
+    dictionaryFile.close();
+  }
+
+  return encodedBits;
+}
+
+inline PackedBits lz78Encode(LZ78Codebook &codebook, const std::string &input) {
+  return lz78Encode(codebook, input.data(), input.size());
+}
+
+// 把码流直接解码到out中，最多写出capacity个字节，返回写出的字节数；
+// 段号越界时返回-1。字典中每个段只记录它在输出中第一次出现的位置和长度，
+// 新的段由该位置复制前缀再加一个字符得到，不需要为每个段分配内存
+inline int64_t lz78DecodeInto(const LZ78Codebook &codebook, const uint8_t *data,
+                              size_t size, uint64_t bitCount, char *out,
+                              size_t capacity) {
+  const int segBits = codebook.segBits;
+  const int symbolBits = codebook.symbolBits;
+  int pairBits = segBits + symbolBits;
+  if (pairBits == 0)
+    return 0;
+  size_t pairs = bitCount / pairBits;
+  std::vector<size_t> phraseStart;
+  std::vector<uint32_t> phraseLength;
+  phraseStart.reserve(pairs + 1);
+  phraseLength.reserve(pairs + 1);
+  phraseStart.push_back(0); // 段号0为空串
+  phraseLength.push_back(0);
+
+  // 解码
+  BitReader reader(data, size);
+  size_t outPos = 0;
+  while (reader.position() + pairBits <= bitCount && outPos < capacity) {
+    // 提取出段号和符号
+    uint32_t index = reader.readBits(segBits);
+    int symbol = reader.readBits(symbolBits);
+    if (index >= phraseStart.size())
+      return -1;
+
+    // 前缀一定位于已输出的部分，与写入位置不重叠
+    size_t length = phraseLength[index];
+    if (outPos + length >= capacity) {
+      memcpy(out + outPos, out + phraseStart[index], capacity - outPos);
+      return capacity;
+    }
+    memcpy(out + outPos, out + phraseStart[index], length);
+    out[outPos + length] = (char)codebook.reverseSymbolTable[symbol];
+
+    phraseStart.push_back(outPos);
+    phraseLength.push_back(length + 1);
+    outPos += length + 1;
+  }
+  return outPos;
+}
+
+// 先只读段号求出原文长度，一次分配好输出缓冲区再解码
+inline std::string lz78Decode(const LZ78Codebook &codebook, const uint8_t *data,
+                              size_t size, uint64_t bitCount) {
+  const int segBits = codebook.segBits;
+  const int symbolBits = codebook.symbolBits;
+  int pairBits = segBits + symbolBits;
+  if (pairBits == 0)
+    return "";
+  std::vector<uint32_t> phraseLength(1, 0);
+  phraseLength.reserve(bitCount / pairBits + 1);
+  size_t total = 0;
+  BitReader reader(data, size);
+  while (reader.position() + pairBits <= bitCount) {
+    uint32_t index = reader.readBits(segBits);
+    reader.readBits(symbolBits);
+    if (index >= phraseLength.size())
+      return "";
+    phraseLength.push_back(phraseLength[index] + 1);
+    total += phraseLength.back();
+  }
+
+  std::string decodedText(total, '\0');
+  int64_t written = lz78DecodeInto(codebook, data, size, bitCount,
+                                   &decodedText[0], total);
+  decodedText.resize(written < 0 ? 0 : written);
+  return decodedText;
+}
+
+inline std::string lz78Decode(const LZ78Codebook &codebook,
+                              const PackedBits &encodedBits) {
+  return lz78Decode(codebook, encodedBits.bytes.data(),
+                    encodedBits.bytes.size(), encodedBits.bitCount);
+}
+
+// LZ77/LZSS：在滑动窗口内查找最长匹配，输出(字面量, 匹配)序列。
+// 序列格式（字节对齐）：
+//   1字节标记(高4位字面量个数, 低4位匹配长度-LZ77_MIN_MATCH)
+//   + 字面量个数的扩展字节 + 字面量 + 距离(变长整数) + 匹配长度的扩展字节
+// 标记中的值为15时后面跟扩展字节，每个扩展字节累加0~255，小于255时结束。
+// 最后一个序列只有字面量，解码端读到输入末尾就结束
+const int LZ77_MIN_MATCH = 4;
+const int LZ77_HASH_BITS = 16;
+const int LZ77_MIN_WINDOW_BITS = 10;
+const int LZ77_MAX_WINDOW_BITS = 24;
+
+// 压缩级别：级别越高，沿哈希链查找的候选越多，压缩率越高、速度越慢
+struct LZ77Level {
+  int maxChain;       // 每个位置最多检查的候选数
+  bool lazy;          // 是否惰性匹配：下一个位置的匹配更长时先输出一个字面量
+  size_t niceLength;  // 找到这么长的匹配就停止查找
+  bool insertMatched; // 是否把匹配内部的位置也加入哈希链
+};
+
+const LZ77Level LZ77_LEVELS[] = {
+    {1, false, 8, false},        // 0：只看最近一个候选
+    {4, false, 16, false},       // 1
+    {8, false, 32, true},        // 2
+    {16, false, 64, true},       // 3
+    {16, true, 64, true},        // 4
+    {32, true, 128, true},       // 5
+    {64, true, 128, true},       // 6
+    {256, true, 256, true},      // 7
+    {1024, true, 1024, true},    // 8
+    {4096, true, 1 << 16, true}, // 9
+};
+const int LZ77_MAX_LEVEL = 9;
+
+struct LZ77Options {
+  int level = 6;
+  int windowBits = 16; // 窗口大小为2^windowBits字节
+};
+
+// 从a和b开始比较，返回相同的字节数，b不超过end
+inline size_t matchLength(const uint8_t *a, const uint8_t *b,
+                          const uint8_t *end) {
+  const uint8_t *start = b;
+  while (b + 8 <= end) {
+    uint64_t x, y;
+    memcpy(&x, a, 8);
+    memcpy(&y, b, 8);
+    if (x != y)
+      return b - start + (__builtin_ctzll(x ^ y) >> 3); // 小端序：最低的不同字节
+    a += 8;
+    b += 8;
+  }
+  while (b < end && *a == *b) {
+    a++;
+    b++;
+  }
+  return b - start;
+}
+
+// 哈希链匹配查找：head按前4个字节的哈希值记录最近的位置，
+// prev记录窗口内每个位置的上一个同哈希位置。位置都存为pos+1，0表示没有
+class LZ77MatchFinder {
+public:
+  LZ77MatchFinder(const uint8_t *data, size_t size, int windowBits)
+      : data(data), size(size), windowSize((size_t)1 << windowBits),
+        head((size_t)1 << LZ77_HASH_BITS, 0),
+        prev(std::min(windowSize, size + 1), 0) {}
+
+  // 把[inserted, pos)中的位置加入哈希链
+  void insertUpTo(size_t pos) {
+    for (; inserted < pos && inserted + LZ77_MIN_MATCH <= size; inserted++) {
+      uint32_t &first = head[hash(inserted)];
+      prev[inserted % prev.size()] = first;
+      first = (uint32_t)inserted + 1;
+    }
+    inserted = std::max(inserted, pos);
+  }
+
+  // 跳过[inserted, pos)，这些位置不再加入哈希链
+  void skipTo(size_t pos) { inserted = std::max(inserted, pos); }
+
+  // 查找pos处的最长匹配，返回长度（不足LZ77_MIN_MATCH时返回0）和距离
+  size_t find(size_t pos, const LZ77Level &level, size_t &offset) {
+    insertUpTo(pos);
+    if (pos + LZ77_MIN_MATCH > size)
+      return 0;
+    const uint8_t *current = data + pos;
+    const uint8_t *end = data + size;
+    size_t best = LZ77_MIN_MATCH - 1;
+    uint32_t candidate = head[hash(pos)];
+    for (int chain = level.maxChain; candidate != 0 && chain > 0; chain--) {
+      size_t match = candidate - 1;
+      if (pos - match >= windowSize)
+        break;
+      // 先比较当前最长匹配之后的那个字节，不可能更长的候选直接跳过
+      if (data[match + best] == current[best] &&
+          memcmp(data + match, current, LZ77_MIN_MATCH) == 0) {
+        size_t length = matchLength(data + match, current, end);
+        if (length > best) {
+          best = length;
+          offset = pos - match;
+          if (length >= level.niceLength || pos + length == size)
+            break;
+        }
+      }
+      candidate = prev[match % prev.size()];
+    }
+    return best >= LZ77_MIN_MATCH ? best : 0;
+  }
+
+private:
+  uint32_t hash(size_t pos) const {
+    uint32_t word;
+    memcpy(&word, data + pos, 4);
+    return (word * 2654435761u) >> (32 - LZ77_HASH_BITS);
+  }
+
+  const uint8_t *data;
+  size_t size;
+  size_t windowSize;
+  size_t inserted = 0; // 小于inserted的位置都已加入哈希链
+  std::vector<uint32_t> head;
+  std::vector<uint32_t> prev;
+};
+
+// 长度的扩展字节：每字节累加0~255，小于255时结束
+inline void appendLengthBytes(std::vector<uint8_t> &out, size_t length) {
+  for (; length >= 255; length -= 255)
+    out.push_back(255);
+  out.push_back((uint8_t)length);
+}
+
+inline void appendSequence(std::vector<uint8_t> &out, const uint8_t *literals,
+                           size_t literalCount, size_t matchLength,
+                           size_t offset) {
+  size_t matchCode = matchLength ? matchLength - LZ77_MIN_MATCH : 0;
+  out.push_back((uint8_t)(std::min(literalCount, (size_t)15) << 4 |
+                          std::min(matchCode, (size_t)15)));
+  if (literalCount >= 15)
+    appendLengthBytes(out, literalCount - 15);
+  out.insert(out.end(), literals, literals + literalCount);
+  if (matchLength == 0)
+    return;
+  appendVarint(out, offset);
+  if (matchCode >= 15)
+    appendLengthBytes(out, matchCode - 15);
+}
+
+inline void lz77Encode(const char *input, size_t length,
+                       const LZ77Options &options, std::vector<uint8_t> &out) {
+  const uint8_t *data = (const uint8_t *)input;
+  const LZ77Level &level =
+      LZ77_LEVELS[std::max(0, std::min(options.level, LZ77_MAX_LEVEL))];
+  int windowBits = std::max(LZ77_MIN_WINDOW_BITS,
+                            std::min(options.windowBits, LZ77_MAX_WINDOW_BITS));
+  LZ77MatchFinder finder(data, length, windowBits);
+
+  size_t anchor = 0; // 尚未输出的字面量的起点
+  size_t pos = 0;
+  while (pos + LZ77_MIN_MATCH <= length) {
+    size_t offset;
+    size_t best = finder.find(pos, level, offset);
+    if (best == 0) {
+      pos++;
+      continue;
+    }
+    // 惰性匹配：下一个位置的匹配更长时，当前字节改为字面量
+    while (level.lazy && best < level.niceLength) {
+      size_t nextOffset;
+      size_t next = finder.find(pos + 1, level, nextOffset);
+      if (next <= best)
+        break;
+      pos++;
+      best = next;
+      offset = nextOffset;
+    }
+    appendSequence(out, data + anchor, pos - anchor, best, offset);
+    if (!level.insertMatched) {
+      finder.insertUpTo(pos + 1);
+      finder.skipTo(pos + best);
+    }
+    pos += best;
+    anchor = pos;
+  }
+  appendSequence(out, data + anchor, length - anchor, 0, 0);
+}
+
+// 解码到out中，最多写出capacity个字节，返回写出的字节数；格式错误时返回-1
+inline int64_t lz77DecodeInto(const uint8_t *data, size_t size, char *out,
+                              size_t capacity) {
+  size_t ip = 0;
+  size_t op = 0;
+  auto readLength = [&](size_t &length) {
+    uint8_t byte;
+    do {
+      if (ip >= size)
+        return false;
+      byte = data[ip++];
+      length += byte;
+    } while (byte == 255);
+    return true;
+  };
+
+  while (ip < size) {
+    uint8_t token = data[ip++];
+    size_t literalCount = token >> 4;
+    if (literalCount == 15 && !readLength(literalCount))
+      return -1;
+    if (literalCount > size - ip || literalCount > capacity - op)
+      return -1;
+    memcpy(out + op, data + ip, literalCount);
+    ip += literalCount;
+    op += literalCount;
+    if (ip == size)
+      break; // 最后一个序列
+
+    uint64_t offset;
+    size_t length = token & 15;
+    if (!readVarint(data, size, ip, offset) ||
+        (length == 15 && !readLength(length)))
+      return -1;
+    length += LZ77_MIN_MATCH;
+    if (offset == 0 || offset > op || length > capacity - op)
+      return -1;
+
+    // 复制匹配：距离不小于8时每次复制8字节，剩余空间不足时逐字节复制；
+    // 距离小于8时源和目标重叠，逐字节复制得到重复的模式
+    char *dst = out + op;
+    const char *src = dst - offset;
+    char *end = dst + length;
+    if (offset >= 8 && length + 8 <= capacity - op) {
+      while (dst < end) {
+        memcpy(dst, src, 8);
+        dst += 8;
+        src += 8;
+      }
+    } else {
+      while (dst < end)
+        *dst++ = *src++;
+    }
+    op += length;
+  }
+  return op;
+}
+
+// 流式LZ78：单遍编码，不需要预先扫描输入。段号位宽随字典增长，
+// 字典达到上限后按策略清空重建或冻结不再增长，内存占用恒定。
+// 码流格式：1字节策略 + 4字节小端序字典上限，随后是(段号, 8位字节)对。
+// 字典有n个段时段号的取值为0~n，n+1表示码流结束，位宽为表示n+1所需的位数
+enum LZ78DictionaryPolicy {
+  LZ78_RESET = 0,  // 字典满后清空，从头开始积累
+  LZ78_FREEZE = 1, // 字典满后不再加入新段
+};
+
+struct LZ78StreamOptions {
+  uint32_t maxDictionarySize = 1 << 16; // 字典中最多的段数
+  LZ78DictionaryPolicy policy = LZ78_RESET;
+};
+
+inline int bitWidth(uint32_t value) {
+  int bits = 1;
+  while (bits < 32 && (value >> bits) != 0)
+    bits++;
+  return bits;
+}
+
+class LZ78StreamEncoder {
+public:
+  explicit LZ78StreamEncoder(const LZ78StreamOptions &options = {})
+      : options(options),
+        dictionary(std::min(options.maxDictionarySize, (uint32_t)1 << 20) + 1),
+        writer(buffer) {
+    buffer.push_back((uint8_t)options.policy);
+    for (int i = 0; i < 4; i++)
+      buffer.push_back((uint8_t)(options.maxDictionarySize >> (8 * i)));
+  }
+
+  // 输入一段数据，把已经确定的压缩字节追加到out
+  void update(const char *data, size_t size, std::vector<uint8_t> &out) {
+    for (size_t i = 0; i < size; i++) {
+      unsigned char c = data[i];
+      if (frozen()) {
+        int child = dictionary.find(node, c);
+        if (child >= 0) {
+          node = child;
+        } else {
+          emit(node, c);
+          node = 0;
+        }
+        continue;
+      }
+      bool inserted;
+      int child = dictionary.findOrInsert(node, c, inserted);
+      if (!inserted) {
+        node = child;
+        continue;
+      }
+      // 新段已经加入字典，段号位宽按加入前的字典大小计算
+      emit(node, c);
+      node = 0;
+      addEntry();
+    }
+    drain(out);
+  }
+
+  // 输出最后不完整的段和结束标记
+  void finish(std::vector<uint8_t> &out) {
+    if (node != 0) {
+      // 解码端会把这一对也加入字典，结束标记的位宽要跟着变化
+      emit(dictionary.parent(node), dictionary.lastByte(node));
+      node = 0;
+      if (!frozen())
+        addEntry();
+    }
+    writer.writeBits(entries + 1, bitWidth(entries + 1));
+    writer.flush();
+    drain(out);
+  }
+
+private:
+  bool frozen() const { return entries >= options.maxDictionarySize; }
+
+  void addEntry() {
+    entries++;
+    if (entries == options.maxDictionarySize && options.policy == LZ78_RESET) {
+      dictionary.clear();
+      entries = 0;
+    }
+  }
+
+  void emit(int index, unsigned char c) {
+    writer.writeBits(index, bitWidth(entries + 1));
+    writer.writeBits(c, 8);
+  }
+
+  void drain(std::vector<uint8_t> &out) {
+    out.insert(out.end(), buffer.begin(), buffer.end());
+    buffer.clear();
+  }
+
+  LZ78StreamOptions options;
+  LZ78Trie dictionary;
+  std::vector<uint8_t> buffer; // BitWriter写出的完整字节，每次update后转交给调用方
+  BitWriter writer;
+  int node = 0;         // 当前串对应的字典树节点
+  uint32_t entries = 0; // 字典中的段数
+};
+
+// 流式解码：每个段只保存父段号、最后一个字节和长度，
+// 沿父段链从后往前把段写入输出，不引用已经交给调用方的输出
+class LZ78StreamDecoder {
+public:
+  // 输入一段压缩数据，把解出的字节追加到out；格式错误时返回false
+  bool update(const uint8_t *data, size_t size, std::string &out) {
+    for (size_t i = 0; i < size && !finished; i++) {
+      if (header.size() < 5) {
+        header.push_back(data[i]);
+        if (header.size() == 5 && !readHeader())
+          return false;
+        continue;
+      }
+      acc = (acc << 8) | data[i];
+      accBits += 8;
+      // 每对最多32+8位，累加器中的比特足够时就解出一对
+      while (!finished) {
+        int width = bitWidth(entries + 1);
+        if (accBits < width + 8) {
+          if (accBits >= width && peek(width) == entries + 1)
+            finished = true;
+          break;
+        }
+        uint32_t index = take(width);
+        if (index == entries + 1) {
+          finished = true;
+          break;
+        }
+        if (index > entries)
+          return false;
+        appendPhrase(index, (unsigned char)take(8), out);
+      }
+    }
+    return true;
+  }
+
+  // 是否已经读到结束标记
+  bool done() const { return finished; }
+
+private:
+  bool readHeader() {
+    options.policy = (LZ78DictionaryPolicy)header[0];
+    options.maxDictionarySize = 0;
+    for (int i = 0; i < 4; i++)
+      options.maxDictionarySize |= (uint32_t)header[1 + i] << (8 * i);
+    if (options.policy > LZ78_FREEZE || options.maxDictionarySize == 0)
+      return false;
+    parents.assign(1, 0);
+    lastBytes.assign(1, 0);
+    lengths.assign(1, 0);
+    size_t capacity =
+        std::min(options.maxDictionarySize, (uint32_t)1 << 20) + 1;
+    parents.reserve(capacity);
+    lastBytes.reserve(capacity);
+    lengths.reserve(capacity);
+    return true;
+  }
+
+  uint32_t peek(int bits) const {
+    return (uint32_t)((acc >> (accBits - bits)) & ((1ULL << bits) - 1));
+  }
+
+  uint32_t take(int bits) {
+    uint32_t value = peek(bits);
+    accBits -= bits;
+    return value;
+  }
+
+  void appendPhrase(uint32_t index, unsigned char c, std::string &out) {
+    size_t start = out.size();
+    out.resize(start + lengths[index] + 1);
+    out[start + lengths[index]] = (char)c;
+    char *p = &out[start + lengths[index]];
+    for (uint32_t n = index; n != 0; n = parents[n])
+      *--p = (char)lastBytes[n];
+
+    if (entries >= options.maxDictionarySize)
+      return; // 冻结
+    parents.push_back(index);
+    lastBytes.push_back(c);
+    lengths.push_back(lengths[index] + 1);
+    entries++;
+    if (entries == options.maxDictionarySize && options.policy == LZ78_RESET) {
+      parents.resize(1);
+      lastBytes.resize(1);
+      lengths.resize(1);
+      entries = 0;
+    }
+  }
+
+  LZ78StreamOptions options;
+  std::vector<uint8_t> header;
+  std::vector<uint32_t> parents;        // 父段号
+  std::vector<unsigned char> lastBytes; // 段的最后一个字节
+  std::vector<uint32_t> lengths;        // 段长
+  uint32_t entries = 0;
+  uint64_t acc = 0; // 低accBits位为未解码的比特
+  int accBits = 0;
+  bool finished = false;
+};
+
+// 分块压缩：出现字节位图(32字节) + 段号位数(1字节) + LZ78码流
+inline void lz78EncodeBlock(const char *data, size_t size,
+                            std::vector<uint8_t> &out) {
+  std::vector<uint64_t> freqs(BYTE_SYMBOLS, 0);
+  countByteFrequencies((const uint8_t *)data, size, freqs.data());
+  LZ78Codebook codebook;
+  buildSymbolTable(freqs, codebook);
+  PackedBits encodedBits = lz78Encode(codebook, data, size);
+  appendPresenceBitmap(out, freqs);
+  out.push_back((uint8_t)codebook.segBits);
+  out.insert(out.end(), encodedBits.bytes.begin(), encodedBits.bytes.end());
+}
+
+inline bool lz78DecodeBlock(const uint8_t *data, size_t size, char *out,
+                            size_t originalSize) {
+  std::vector<uint64_t> freqs;
+  size_t pos = 0;
+  if (!readPresenceBitmap(data, size, pos, freqs) || pos >= size)
+    return false;
+  LZ78Codebook codebook;
+  buildSymbolTable(freqs, codebook);
+  buildReverseSymbolTable(codebook);
+  // 段号不超过字典大小，字典大小不超过原始长度，编码端的段号位数至多为
+  // originalSize的有效位数；更大的值来自损坏的数据，还会让移位越界
+  codebook.segBits = data[pos++];
+  if (codebook.segBits > 32 ||
+      (codebook.segBits > 0 && (originalSize >> (codebook.segBits - 1)) == 0))
+    return false;
+
+  // 块内只记录了字节数，末尾补齐的0可能多解出一段，解到原始长度为止
+  return lz78DecodeInto(codebook, data + pos, size - pos, (size - pos) * 8,
+                        out, originalSize) == (int64_t)originalSize;
+}
+
+// LZ77分块压缩：块内直接存放序列，使用默认级别和窗口
+inline void lz77EncodeBlock(const char *data, size_t size,
+                            std::vector<uint8_t> &out) {
+  lz77Encode(data, size, LZ77Options(), out);
+}
+
+inline bool lz77DecodeBlock(const uint8_t *data, size_t size, char *out,
+                            size_t originalSize) {
+  return lz77DecodeInto(data, size, out, originalSize) ==
+         (int64_t)originalSize;
+}
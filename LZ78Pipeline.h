@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Arithmetic.h"
+#include "BitIO.h"
+#include "ByteModel.h"
+#include "Huffman.h"
+#include "LZ.h"
+
+// LZ78分段 + 熵编码。分段与lz78Encode相同，每段输出(前缀段号, 下一个字节)，
+// 但不再用固定位宽写出，而是像deflate那样把两部分交给各自的模型：
+//   字节：256个符号的字节模型
+//   段号：按位数分桶，桶号(0~32)用桶模型编码，桶内的低位原样写出。
+//         段号v的桶号为v的有效位数，桶b(b >= 2)内另有b-1个附加位。
+//         早期段号小、桶号小，字典越大段号才越长
+// 分段结果通过回调直接交给熵编码阶段，中间不生成字符串
+
+// 桶号：v的有效位数，0的桶号为0
+inline int lz78IndexBucket(uint32_t index) {
+  return index == 0 ? 0 : 32 - __builtin_clz(index);
+}
+
+inline int lz78BucketExtraBits(int bucket) {
+  return bucket >= 2 ? bucket - 1 : 0;
+}
+
+// 对data做LZ78分段，每得到一对就调用emit(段号, 字节)。
+// 末尾不完整的段用它的父段和最后一个字节表示，与lz78Encode相同
+template <typename Emit>
+void lz78Parse(const char *data, size_t size, Emit emit) {
+  LZ78Trie dictionary(std::min(size / 4, (size_t)1 << 20) + 1);
+  int node = 0;
+  for (size_t i = 0; i < size; i++) {
+    unsigned char c = data[i];
+    bool inserted;
+    int child = dictionary.findOrInsert(node, c, inserted);
+    if (inserted) {
+      emit((uint32_t)node, c);
+      node = 0;
+    } else {
+      node = child;
+    }
+  }
+  if (node != 0)
+    emit((uint32_t)dictionary.parent(node), dictionary.lastByte(node));
+}
+
+// 解码端的字典：每段记录它在输出中第一次出现的位置和长度。
+// 追加一段时从该位置复制前缀再加一个字节，写到originalSize为止
+class LZ78PhraseWriter {
+public:
+  LZ78PhraseWriter(char *out, size_t originalSize)
+      : out(out), capacity(originalSize) {
+    phraseStart.reserve(std::min(originalSize, (size_t)1 << 20) + 1);
+    phraseLength.reserve(std::min(originalSize, (size_t)1 << 20) + 1);
+    phraseStart.push_back(0); // 段号0为空串
+    phraseLength.push_back(0);
+  }
+
+  bool full() const { return outPos >= capacity; }
+
+  // 段号越界时返回false
+  bool append(uint32_t index, unsigned char c) {
+    if (index >= phraseStart.size())
+      return false;
+    // 前缀一定位于已输出的部分，与写入位置不重叠
+    size_t length = phraseLength[index];
+    if (outPos + length >= capacity) {
+      memcpy(out + outPos, out + phraseStart[index], capacity - outPos);
+      outPos = capacity;
+      return true;
+    }
+    memcpy(out + outPos, out + phraseStart[index], length);
+    out[outPos + length] = (char)c;
+    phraseStart.push_back(outPos);
+    phraseLength.push_back(length + 1);
+    outPos += length + 1;
+    return true;
+  }
+
+private:
+  char *out;
+  size_t capacity;
+  size_t outPos = 0;
+  std::vector<size_t> phraseStart;
+  std::vector<uint32_t> phraseLength;
+};
+
+// --- 霍夫曼后端 ---
+// 块格式：字节码表头 | 桶码表头 | 每对依次为桶的码字、附加位、字节的码字。
+// 静态码表需要先统计频率，分段结果暂存为两个数组后再编码
+inline void lz78HuffmanEncodeBlock(const char *data, size_t size,
+                                   std::vector<uint8_t> &out) {
+  std::vector<uint32_t> indices;
+  std::vector<uint8_t> literals;
+  std::vector<uint64_t> literalFreqs(BYTE_SYMBOLS, 0);
+  std::vector<uint64_t> bucketFreqs(BYTE_SYMBOLS, 0);
+  lz78Parse(data, size, [&](uint32_t index, unsigned char c) {
+    indices.push_back(index);
+    literals.push_back(c);
+    literalFreqs[c]++;
+    bucketFreqs[lz78IndexBucket(index)]++;
+  });
+
+  std::vector<int> literalLengths = buildCodeLengths(literalFreqs);
+  std::vector<int> bucketLengths = buildCodeLengths(bucketFreqs);
+  std::vector<HuffmanCode> literalCodes = buildCanonicalCodes(literalLengths);
+  std::vector<HuffmanCode> bucketCodes = buildCanonicalCodes(bucketLengths);
+
+  BitWriter writer(out);
+  writeCodeLengths(writer, literalLengths);
+  writeCodeLengths(writer, bucketLengths);
+  for (size_t k = 0; k < indices.size(); k++) {
+    int bucket = lz78IndexBucket(indices[k]);
+    int extra = lz78BucketExtraBits(bucket);
+    writer.writeBits(bucketCodes[bucket].bits, bucketCodes[bucket].length);
+    writer.writeBits(indices[k] & ((1u << extra) - 1), extra);
+    const HuffmanCode &code = literalCodes[literals[k]];
+    writer.writeBits(code.bits, code.length);
+  }
+  writer.flush();
+}
+
+inline bool lz78HuffmanDecodeBlock(const uint8_t *data, size_t size, char *out,
+                                   size_t originalSize) {
+  BitReader reader(data, size);
+  std::vector<int> literalLengths, bucketLengths;
+  if (!readCodeLengths(reader, literalLengths) ||
+      !readCodeLengths(reader, bucketLengths))
+    return false;
+  HuffmanDecodeTable literalTable =
+      buildDecodeTable(buildCanonicalCodes(literalLengths));
+  HuffmanDecodeTable bucketTable =
+      buildDecodeTable(buildCanonicalCodes(bucketLengths));
+  if (originalSize > 0 &&
+      (literalTable.maxLength == 0 || bucketTable.maxLength == 0))
+    return false;
+
+  LZ78PhraseWriter phrases(out, originalSize);
+  while (!phrases.full()) {
+    // 码流读完后BitReader返回0，每对至少输出一个字节，循环次数有限
+    if (reader.position() > (uint64_t)size * 8)
+      return false;
+    char symbol;
+    char *p = &symbol;
+    decodeOne(bucketTable.entries.data(), reader, p);
+    int bucket = (unsigned char)symbol;
+    if (bucket > 32)
+      return false;
+    uint32_t index = bucket == 0 ? 0 : 1u << (bucket - 1);
+    index |= reader.readBits(lz78BucketExtraBits(bucket));
+    p = &symbol;
+    decodeOne(literalTable.entries.data(), reader, p);
+    if (!phrases.append(index, (unsigned char)symbol))
+      return false;
+  }
+  return true;
+}
+
+// --- 算术编码后端 ---
+// 块格式：一个自适应算术编码码流，依次为桶、附加位、字节。
+// 两个模型都从均匀分布开始，边编码边更新，码流中没有频率表，分段只需一遍。
+// 附加位按2^n的总频率直接编码，每次最多ARITHMETIC_RAW_BITS位
+const int ARITHMETIC_RAW_BITS = 15;
+const int LZ78_BUCKETS = 33;
+
+inline AdaptiveFrequencyModel lz78BucketModel() {
+  std::vector<uint32_t> freqs(MODEL_SYMBOLS, 0);
+  std::fill(freqs.begin(), freqs.begin() + LZ78_BUCKETS, 1);
+  return AdaptiveFrequencyModel(freqs);
+}
+
+inline AdaptiveFrequencyModel lz78LiteralModel() {
+  std::vector<uint32_t> freqs(MODEL_SYMBOLS, 1);
+  freqs[EOF_SYMBOL_CONST] = 0;
+  return AdaptiveFrequencyModel(freqs);
+}
+
+inline void lz78ArithmeticEncodeBlock(const char *data, size_t size,
+                                      std::vector<uint8_t> &out) {
+  ArithmeticEncoder encoder(out);
+  AdaptiveFrequencyModel bucketModel = lz78BucketModel();
+  AdaptiveFrequencyModel literalModel = lz78LiteralModel();
+  lz78Parse(data, size, [&](uint32_t index, unsigned char c) {
+    int bucket = lz78IndexBucket(index);
+    encode_model_symbol(encoder, bucketModel, bucket);
+    bucketModel.update(bucket);
+    for (int extra = lz78BucketExtraBits(bucket); extra > 0;) {
+      int bits = std::min(extra, ARITHMETIC_RAW_BITS);
+      extra -= bits;
+      uint32_t value = (index >> extra) & ((1u << bits) - 1);
+      encoder.encode_pow2(value, value + 1, bits);
+    }
+    encode_model_symbol(encoder, literalModel, c);
+    literalModel.update(c);
+  });
+  encoder.finish();
+}
+
+inline bool lz78ArithmeticDecodeBlock(const uint8_t *data, size_t size,
+                                      char *out, size_t originalSize) {
+  ArithmeticDecoder decoder(data, size);
+  AdaptiveFrequencyModel bucketModel = lz78BucketModel();
+  AdaptiveFrequencyModel literalModel = lz78LiteralModel();
+  LZ78PhraseWriter phrases(out, originalSize);
+  while (!phrases.full()) {
+    int bucket = decode_model_symbol(decoder, bucketModel);
+    if (bucket >= LZ78_BUCKETS)
+      return false;
+    bucketModel.update(bucket);
+    uint32_t index = bucket == 0 ? 0 : 1u << (bucket - 1);
+    for (int extra = lz78BucketExtraBits(bucket); extra > 0;) {
+      int bits = std::min(extra, ARITHMETIC_RAW_BITS);
+      extra -= bits;
+      uint32_t value = decoder.target_pow2(bits);
+      decoder.consume(value, value + 1, 1u << bits);
+      index |= value << extra;
+    }
+    int c = decode_model_symbol(decoder, literalModel);
+    if (c >= BYTE_SYMBOLS)
+      return false;
+    literalModel.update(c);
+    if (!phrases.append(index, (unsigned char)c))
+      return false;
+  }
+  return true;
+}
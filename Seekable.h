@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BlockFrame.h"
+#include "Codecs.h"
+#include "Container.h"
+#include "Stream.h"
+
+// 可随机访问的压缩文件：Container.h的格式之后追加块索引（小端序）：
+//   每项16字节：8字节块在原始数据中的偏移 | 8字节块头在文件中的偏移，
+//   最后一项为原始总长度和结束标记的位置 | 8字节项数 | 4字节魔数"DCSK"
+// 流中每块本来就独立压缩，读取任意范围只需解压覆盖它的块。
+// 流式解压读到结束标记就停止，不读索引，因此带索引的文件仍可整体解压
+const uint8_t SEEK_INDEX_MAGIC[4] = {'D', 'C', 'S', 'K'};
+const size_t SEEK_INDEX_ENTRY_SIZE = 16;
+const size_t SEEK_FOOTER_SIZE = 12;
+
+// 追加索引。index来自StreamCompressor，base为流在文件中的起点
+inline void appendSeekIndex(std::vector<uint8_t> &out,
+                            const std::vector<StreamIndexEntry> &index,
+                            uint64_t base) {
+  size_t start = out.size();
+  out.resize(start + index.size() * SEEK_INDEX_ENTRY_SIZE + SEEK_FOOTER_SIZE);
+  size_t pos = start;
+  for (const StreamIndexEntry &entry : index) {
+    putLE64(out, pos, entry.originalOffset);
+    putLE64(out, pos + 8, base + entry.streamOffset);
+    pos += SEEK_INDEX_ENTRY_SIZE;
+  }
+  putLE64(out, pos, index.size());
+  memcpy(out.data() + pos + 8, SEEK_INDEX_MAGIC, 4);
+}
+
+// 在整个压缩文件（通常是mmap映射的内存）上按原始偏移读取任意范围。
+// 按原始偏移二分查找索引，只解压覆盖范围的块；最近解压的一块留在缓存中，
+// 连续的小范围读取不会重复解压同一块
+class SeekableReader {
+public:
+  // 检查文件头和索引，不是带索引的压缩文件或索引与流不一致时返回false。
+  // data在读取期间必须有效
+  bool open(const uint8_t *data, size_t size) {
+    file = data;
+    cachedBlock = SIZE_MAX;
+    ContainerHeader header;
+    size_t streamStart = CONTAINER_HEADER_SIZE;
+    if (size < streamStart + 4 + SEEK_FOOTER_SIZE ||
+        !readContainerHeader(data, header) ||
+        memcmp(data + size - 4, SEEK_INDEX_MAGIC, 4) != 0)
+      return false;
+    blockSize = getLE32(data + streamStart);
+    uint64_t count = getLE64(data + size - SEEK_FOOTER_SIZE);
+    uint64_t indexEnd = size - SEEK_FOOTER_SIZE;
+    if (blockSize == 0 || count == 0 ||
+        count > (indexEnd - streamStart) / SEEK_INDEX_ENTRY_SIZE)
+      return false;
+
+    const uint8_t *p = data + indexEnd - count * SEEK_INDEX_ENTRY_SIZE;
+    index.resize(count);
+    for (size_t i = 0; i < count; i++, p += SEEK_INDEX_ENTRY_SIZE) {
+      index[i].originalOffset = getLE64(p);
+      index[i].streamOffset = getLE64(p + 8);
+    }
+    // 第一块紧接流头；每块不超过块大小，块头和结束标记都在索引之前
+    uint64_t indexStart = indexEnd - count * SEEK_INDEX_ENTRY_SIZE;
+    if (index[0].originalOffset != 0 ||
+        index[0].streamOffset != streamStart + 4 ||
+        index.back().streamOffset + 8 > indexStart)
+      return false;
+    for (size_t i = 0; i + 1 < count; i++) {
+      if (index[i + 1].originalOffset <= index[i].originalOffset ||
+          index[i + 1].originalOffset - index[i].originalOffset > blockSize ||
+          index[i + 1].streamOffset <= index[i].streamOffset + 8)
+        return false;
+    }
+    if (header.originalLength != UNKNOWN_LENGTH &&
+        header.originalLength != length())
+      return false;
+    decodeBlock = checkedDecoder(codecs()[header.codecId].decodeBlock);
+    return true;
+  }
+
+  // 原始数据总长度
+  uint64_t length() const { return index.back().originalOffset; }
+
+  size_t blockCount() const { return index.size() - 1; }
+
+  // 把原始数据[offset, offset + size)追加到out，范围超出总长度或数据损坏时
+  // 返回false
+  bool read(uint64_t offset, uint64_t size, std::string &out) {
+    if (offset > length() || size > length() - offset)
+      return false;
+    uint64_t end = offset + size;
+    for (size_t block = findBlock(offset); offset < end; block++) {
+      if (!loadBlock(block))
+        return false;
+      uint64_t blockStart = index[block].originalOffset;
+      uint64_t blockEnd = index[block + 1].originalOffset;
+      uint64_t n = std::min(end, blockEnd) - offset;
+      out.append(cache.data() + (offset - blockStart), n);
+      offset += n;
+    }
+    return true;
+  }
+
+private:
+  // 包含原始偏移offset的块，即最后一个起点不大于offset的块
+  size_t findBlock(uint64_t offset) const {
+    size_t lo = 0, hi = index.size() - 1; // 在[lo, hi)中二分
+    while (hi - lo > 1) {
+      size_t mid = (lo + hi) / 2;
+      if (index[mid].originalOffset <= offset)
+        lo = mid;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+
+  // 解压第block块到缓存，已在缓存中时直接返回
+  bool loadBlock(size_t block) {
+    if (block == cachedBlock)
+      return true;
+    cachedBlock = SIZE_MAX;
+    const StreamIndexEntry &entry = index[block];
+    const uint8_t *header = file + entry.streamOffset;
+    uint32_t originalSize = getLE32(header);
+    uint32_t compressedSize = getLE32(header + 4);
+    // 块头要与索引一致，压缩数据恰好延伸到下一块的块头
+    if (originalSize !=
+            index[block + 1].originalOffset - entry.originalOffset ||
+        entry.streamOffset + 8 + compressedSize !=
+            index[block + 1].streamOffset)
+      return false;
+    cache.resize(originalSize);
+    if (!decodeBlock(header + 8, compressedSize, cache.data(), originalSize))
+      return false;
+    cachedBlock = block;
+    return true;
+  }
+
+  const uint8_t *file = nullptr;
+  uint32_t blockSize = 0;
+  std::vector<StreamIndexEntry> index; // 最后一项为总长度和结束标记
+  BlockDecoder decodeBlock;
+  std::vector<char> cache; // 最近解压的一块
+  size_t cachedBlock = SIZE_MAX;
+};
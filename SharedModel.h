@@ -0,0 +1,492 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Arithmetic.h"
+#include "BitIO.h"
+#include "BlockFrame.h"
+#include "ByteModel.h"
+#include "Checksum.h"
+#include "Huffman.h"
+#include "LZ.h"
+
+// 预训练的共享模型，用于很小的消息（如一行日志或一条JSON记录）。
+// 分块编码器每块都要写出自己的码表或频率表，LZ的字典也从空开始，
+// 对不到1KB的消息，这些开销比数据本身还大。共享模型由Train从样本语料训练：
+//   整条消息的零阶霍夫曼码长和算术编码频率
+//   LZ启动字典：样本中最常出现的片段，消息可以直接引用
+//   LZ记号（命令、字面字节、偏移桶）的霍夫曼码长
+// 模型文件启动时用mmap映射，字典直接引用映射的内存，码表和查找表只在加载时
+// 构建一次。之后压缩、解压每条消息都不再建模，除输出缓冲区外不分配内存
+//
+// 模型文件格式（小端序）：
+//   4字节魔数"DCMD" | 1字节版本 | 3字节保留 | 4字节模型编号 | 4字节字典长度 |
+//   4组256字节的码长：整条消息、LZ字面字节、LZ命令、LZ偏移桶 |
+//   256个4字节的字节频率 | 字典 | 4字节CRC32C（之前全部内容）
+const uint8_t SHARED_MODEL_MAGIC[4] = {'D', 'C', 'M', 'D'};
+const uint8_t SHARED_MODEL_VERSION = 1;
+const size_t SHARED_MODEL_HEADER_SIZE = 16;
+const size_t SHARED_MODEL_TABLES_SIZE = 4 * BYTE_SYMBOLS + 4 * BYTE_SYMBOLS;
+const size_t SHARED_MAX_DICTIONARY = (size_t)1 << 24;
+
+// 消息帧：4字节模型编号 | 1字节方法 | 变长原始长度 | 载荷。
+// 小消息的帧不带校验，需要时由上层协议负责
+enum SharedMethod {
+  SHARED_STORED = 0,     // 原样保存，压缩后不更小时使用
+  SHARED_HUFFMAN = 1,    // 共享的零阶霍夫曼码
+  SHARED_ARITHMETIC = 2, // 共享的零阶算术编码频率
+  SHARED_LZ = 3,         // 共享字典上的LZ77，记号用共享的霍夫曼码
+};
+const int SHARED_METHODS = 4;
+
+// LZ记号：命令 = 字面长度桶 << 4 | 匹配字段桶，之后依次为字面长度附加位、
+// 各字面字节、匹配字段附加位、偏移桶和偏移附加位。匹配字段为0表示没有匹配，
+// 否则为匹配长度 - LZ77_MIN_MATCH + 1。
+// 字段v < 8时桶号为v；否则桶号为v的有效位数 + 4，附加位为去掉最高位的其余位
+const uint32_t SHARED_MAX_FIELD = 2047; // 桶号不超过15
+const size_t SHARED_MAX_MATCH = SHARED_MAX_FIELD + LZ77_MIN_MATCH - 1;
+const int SHARED_OFFSET_BUCKETS = 33;    // 偏移的有效位数，1~32
+const int SHARED_HASH_BITS = 16;         // 字典索引
+const int SHARED_MESSAGE_HASH_BITS = 12; // 每条消息自己的哈希表，放在栈上
+const int SHARED_DICTIONARY_CHAIN = 16;  // 每个位置最多查看的字典候选数
+
+inline int sharedFieldBucket(uint32_t value) {
+  return value < 8 ? (int)value : 32 - __builtin_clz(value) + 4;
+}
+
+inline int sharedFieldExtraBits(int bucket) {
+  return bucket < 8 ? 0 : bucket - 5;
+}
+
+inline uint32_t sharedFieldBase(int bucket) {
+  return bucket < 8 ? bucket : 1u << (bucket - 5);
+}
+
+// 匹配长度 -> 匹配字段，0表示没有匹配
+inline uint32_t sharedMatchField(size_t length) {
+  return length == 0 ? 0 : (uint32_t)(length - LZ77_MIN_MATCH + 1);
+}
+
+inline int sharedOffsetBucket(size_t offset) {
+  return 32 - __builtin_clz((uint32_t)offset);
+}
+
+inline uint32_t sharedHash(const uint8_t *p, int bits) {
+  uint32_t word;
+  memcpy(&word, p, 4);
+  return (word * 2654435761u) >> (32 - bits);
+}
+
+// 训练结果，由Train写成模型文件
+struct SharedModelTables {
+  uint32_t modelId = 0;
+  std::vector<int> byteLengths;    // 整条消息的零阶霍夫曼码长
+  std::vector<int> literalLengths; // LZ字面字节
+  std::vector<int> commandLengths; // LZ命令
+  std::vector<int> offsetLengths;  // LZ偏移桶
+  std::vector<uint64_t> byteFreqs; // 算术编码的字节频率
+  std::string dictionary;
+};
+
+inline void writeSharedModel(const SharedModelTables &tables,
+                             std::vector<uint8_t> &out) {
+  size_t start = out.size();
+  out.insert(out.end(), SHARED_MODEL_MAGIC, SHARED_MODEL_MAGIC + 4);
+  out.push_back(SHARED_MODEL_VERSION);
+  out.resize(start + SHARED_MODEL_HEADER_SIZE + SHARED_MODEL_TABLES_SIZE);
+  putLE32(out, start + 8, tables.modelId);
+  putLE32(out, start + 12, (uint32_t)tables.dictionary.size());
+  uint8_t *lengths = out.data() + start + SHARED_MODEL_HEADER_SIZE;
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    lengths[s] = (uint8_t)tables.byteLengths[s];
+    lengths[BYTE_SYMBOLS + s] = (uint8_t)tables.literalLengths[s];
+    lengths[2 * BYTE_SYMBOLS + s] = (uint8_t)tables.commandLengths[s];
+    lengths[3 * BYTE_SYMBOLS + s] = (uint8_t)tables.offsetLengths[s];
+  }
+  size_t freqStart = start + SHARED_MODEL_HEADER_SIZE + 4 * BYTE_SYMBOLS;
+  for (int s = 0; s < BYTE_SYMBOLS; s++) {
+    uint64_t freq = std::min<uint64_t>(tables.byteFreqs[s], UINT32_MAX);
+    putLE32(out, freqStart + 4 * s, (uint32_t)freq);
+  }
+  out.insert(out.end(), tables.dictionary.begin(), tables.dictionary.end());
+  size_t crcStart = out.size();
+  out.resize(crcStart + 4);
+  putLE32(out, crcStart, crc32c(out.data() + start, crcStart - start));
+}
+
+// 帧头
+struct SharedFrameHeader {
+  uint32_t modelId = 0;
+  int method = SHARED_STORED;
+  uint64_t originalSize = 0;
+  size_t headerSize = 0;
+};
+
+// 解析帧头，不完整或方法未知时返回false。解压前可以先用它取得模型编号和长度
+inline bool readSharedFrameHeader(const uint8_t *data, size_t size,
+                                  SharedFrameHeader &header) {
+  if (size < 5 || data[4] >= SHARED_METHODS)
+    return false;
+  header.modelId = getLE32(data);
+  header.method = data[4];
+  size_t pos = 5;
+  if (!readVarint(data, size, pos, header.originalSize))
+    return false;
+  header.headerSize = pos;
+  return true;
+}
+
+class SharedModel {
+public:
+  SharedModel() = default;
+
+  ~SharedModel() { unmap(); }
+
+  SharedModel(const SharedModel &) = delete;
+  SharedModel &operator=(const SharedModel &) = delete;
+
+  // 映射模型文件并解析，文件不存在或内容不合法时返回false
+  bool load(const char *path) {
+    unmap();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+      p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // 映射在关闭文件后仍然有效
+    if (p == MAP_FAILED)
+      return false;
+    mapped = p;
+    mappedSize = st.st_size;
+    if (!parse((const uint8_t *)p, mappedSize)) {
+      unmap();
+      return false;
+    }
+    return true;
+  }
+
+  // 从内存中的模型文件内容解析，data在模型使用期间必须有效
+  bool parse(const uint8_t *data, size_t size) {
+    size_t fixed = SHARED_MODEL_HEADER_SIZE + SHARED_MODEL_TABLES_SIZE;
+    if (size < fixed + 4 || memcmp(data, SHARED_MODEL_MAGIC, 4) != 0 ||
+        data[4] != SHARED_MODEL_VERSION)
+      return false;
+    size_t dictSize = getLE32(data + 12);
+    if (dictSize > SHARED_MAX_DICTIONARY || size != fixed + dictSize + 4 ||
+        crc32c(data, size - 4) != getLE32(data + size - 4))
+      return false;
+
+    const uint8_t *lengths = data + SHARED_MODEL_HEADER_SIZE;
+    if (!loadCode(lengths, BYTE_SYMBOLS, byteCode) ||
+        !loadCode(lengths + BYTE_SYMBOLS, BYTE_SYMBOLS, literalCode) ||
+        !loadCode(lengths + 2 * BYTE_SYMBOLS, BYTE_SYMBOLS, commandCode) ||
+        !loadCode(lengths + 3 * BYTE_SYMBOLS, SHARED_OFFSET_BUCKETS,
+                  offsetCode))
+      return false;
+    const uint8_t *freqData = lengths + 4 * BYTE_SYMBOLS;
+    std::vector<uint64_t> freqs(BYTE_SYMBOLS);
+    for (int s = 0; s < BYTE_SYMBOLS; s++) {
+      freqs[s] = getLE32(freqData + 4 * s);
+      if (freqs[s] == 0)
+        return false; // 每个字节都要能编码
+    }
+    arithmeticModel.build(freqs);
+
+    modelId = getLE32(data + 8);
+    dictionary = data + fixed;
+    dictionarySize = dictSize;
+    buildDictionaryIndex();
+    return true;
+  }
+
+  uint32_t id() const { return modelId; }
+
+  // 用方法method压缩一条消息，帧追加到out末尾。压缩后不比原文小时改为原样保存
+  void compress(const char *data, size_t size, std::vector<uint8_t> &out,
+                int method = SHARED_LZ) const {
+    size_t start = out.size();
+    out.resize(start + 5);
+    putLE32(out, start, modelId);
+    out[start + 4] = (uint8_t)method;
+    appendVarint(out, size);
+    size_t payloadStart = out.size();
+    const uint8_t *input = (const uint8_t *)data;
+    if (method == SHARED_HUFFMAN)
+      encodeHuffman(input, size, out);
+    else if (method == SHARED_ARITHMETIC)
+      encodeArithmetic(input, size, out);
+    else if (method == SHARED_LZ)
+      encodeLZ(input, size, out);
+    if (method != SHARED_STORED && out.size() - payloadStart < size)
+      return;
+    out[start + 4] = SHARED_STORED;
+    out.resize(payloadStart);
+    out.insert(out.end(), input, input + size);
+  }
+
+  // 解压一帧到out，out至少要有帧头中原始长度的空间（capacity）。
+  // 模型编号不符、空间不足或数据不合法时返回false
+  bool decompress(const uint8_t *data, size_t size, char *out,
+                  size_t capacity, size_t &outSize) const {
+    SharedFrameHeader header;
+    if (!readSharedFrameHeader(data, size, header) ||
+        header.modelId != modelId || header.originalSize > capacity)
+      return false;
+    outSize = header.originalSize;
+    const uint8_t *payload = data + header.headerSize;
+    size_t payloadSize = size - header.headerSize;
+    uint8_t *output = (uint8_t *)out;
+    switch (header.method) {
+    case SHARED_STORED:
+      if (payloadSize != outSize)
+        return false;
+      memcpy(output, payload, payloadSize);
+      return true;
+    case SHARED_HUFFMAN:
+      return decodeHuffman(payload, payloadSize, output, outSize);
+    case SHARED_ARITHMETIC:
+      return decodeArithmetic(payload, payloadSize, output, outSize);
+    default:
+      return decodeLZ(payload, payloadSize, output, outSize);
+    }
+  }
+
+  // LZ分段：每得到一个记号调用emit(字面起点, 字面长度, 匹配长度, 偏移)，
+  // 匹配长度为0表示没有匹配。偏移从当前位置往前数，超过当前位置的部分落在
+  // 字典末尾。先查消息自己的哈希表，再沿字典的哈希链查找，取最长的匹配。
+  // Train用它统计记号频率，压缩时直接编码
+  template <typename Emit>
+  void parseLZ(const uint8_t *data, size_t size, Emit emit) const {
+    uint32_t recent[1 << SHARED_MESSAGE_HASH_BITS]; // 位置+1，0表示没有
+    memset(recent, 0, sizeof(recent));
+    size_t pos = 0, literalStart = 0;
+    while (pos + LZ77_MIN_MATCH <= size) {
+      if (pos - literalStart == SHARED_MAX_FIELD) {
+        emit(literalStart, pos - literalStart, (size_t)0, (size_t)0);
+        literalStart = pos;
+      }
+      size_t maxLength = std::min(size - pos, SHARED_MAX_MATCH);
+      size_t bestLength = 0, bestOffset = 0;
+      uint32_t &slot = recent[sharedHash(data + pos, SHARED_MESSAGE_HASH_BITS)];
+      if (slot != 0) {
+        size_t length = matchLength(data + slot - 1, data + pos,
+                                    data + pos + maxLength);
+        if (length >= (size_t)LZ77_MIN_MATCH) {
+          bestLength = length;
+          bestOffset = pos - (slot - 1);
+        }
+      }
+      slot = (uint32_t)pos + 1;
+      int steps = SHARED_DICTIONARY_CHAIN;
+      uint32_t c = dictionaryHead[sharedHash(data + pos, SHARED_HASH_BITS)];
+      for (; c != 0 && steps-- > 0; c = dictionaryPrev[c - 1]) {
+        // 匹配不越过字典末尾
+        size_t limit = std::min(maxLength, dictionarySize - (c - 1));
+        size_t length =
+            matchLength(dictionary + c - 1, data + pos, data + pos + limit);
+        if (length > bestLength && length >= (size_t)LZ77_MIN_MATCH) {
+          bestLength = length;
+          bestOffset = pos + dictionarySize - (c - 1);
+        }
+      }
+      if (bestLength == 0) {
+        pos++;
+        continue;
+      }
+      emit(literalStart, pos - literalStart, bestLength, bestOffset);
+      for (size_t p = pos + 1; p < pos + bestLength && p + 4 <= size; p++)
+        recent[sharedHash(data + p, SHARED_MESSAGE_HASH_BITS)] = p + 1;
+      pos += bestLength;
+      literalStart = pos;
+    }
+    while (literalStart < size) {
+      size_t run = std::min<size_t>(size - literalStart, SHARED_MAX_FIELD);
+      emit(literalStart, run, (size_t)0, (size_t)0);
+      literalStart += run;
+    }
+  }
+
+  const uint8_t *dictionaryData() const { return dictionary; }
+  size_t dictionaryLength() const { return dictionarySize; }
+
+private:
+  struct SharedCode {
+    std::vector<HuffmanCode> codes;
+    HuffmanDecodeTable table;
+  };
+
+  // 前count个符号都必须有码字，保证任何输入都能编码
+  static bool loadCode(const uint8_t *lengths, int count, SharedCode &code) {
+    std::vector<int> codeLengths(BYTE_SYMBOLS, 0);
+    for (int s = 0; s < BYTE_SYMBOLS; s++) {
+      codeLengths[s] = lengths[s];
+      if ((s < count) != (lengths[s] > 0))
+        return false;
+    }
+    if (!validCodeLengths(codeLengths))
+      return false;
+    code.codes = buildCanonicalCodes(codeLengths);
+    code.table = buildDecodeTable(code.codes);
+    return true;
+  }
+
+  void buildDictionaryIndex() {
+    dictionaryHead.assign((size_t)1 << SHARED_HASH_BITS, 0);
+    dictionaryPrev.assign(dictionarySize, 0);
+    for (size_t i = 0; i + LZ77_MIN_MATCH <= dictionarySize; i++) {
+      uint32_t &head = dictionaryHead[sharedHash(dictionary + i,
+                                                 SHARED_HASH_BITS)];
+      dictionaryPrev[i] = head;
+      head = (uint32_t)i + 1;
+    }
+  }
+
+  void unmap() {
+    if (mapped)
+      munmap(mapped, mappedSize);
+    mapped = nullptr;
+    mappedSize = 0;
+  }
+
+  static void writeSymbol(BitWriter &writer, const SharedCode &code, int s) {
+    writer.writeBits(code.codes[s].bits, code.codes[s].length);
+  }
+
+  static int readSymbol(BitReader &reader, const SharedCode &code) {
+    char symbol;
+    char *p = &symbol;
+    decodeOne(code.table.entries.data(), reader, p);
+    return (unsigned char)symbol;
+  }
+
+  static void writeField(BitWriter &writer, uint32_t value, int bucket) {
+    writer.writeBits(value - sharedFieldBase(bucket),
+                     sharedFieldExtraBits(bucket));
+  }
+
+  static uint32_t readField(BitReader &reader, int bucket) {
+    return sharedFieldBase(bucket) +
+           reader.readBits(sharedFieldExtraBits(bucket));
+  }
+
+  void encodeHuffman(const uint8_t *data, size_t size,
+                     std::vector<uint8_t> &out) const {
+    BitWriter writer(out);
+    for (size_t i = 0; i < size; i++)
+      writeSymbol(writer, byteCode, data[i]);
+    writer.flush();
+  }
+
+  bool decodeHuffman(const uint8_t *data, size_t size, uint8_t *out,
+                     size_t originalSize) const {
+    BitReader reader(data, size);
+    for (size_t i = 0; i < originalSize; i++)
+      out[i] = (uint8_t)readSymbol(reader, byteCode);
+    return reader.position() <= (uint64_t)size * 8;
+  }
+
+  // 长度已知，不编码EOF符号
+  void encodeArithmetic(const uint8_t *data, size_t size,
+                        std::vector<uint8_t> &out) const {
+    ArithmeticEncoder encoder(out);
+    for (size_t i = 0; i < size; i++) {
+      encoder.encode_pow2(arithmeticModel.cum_low(data[i]),
+                          arithmeticModel.cum_high(data[i]),
+                          MODEL_TOTAL_BITS);
+    }
+    encoder.finish();
+  }
+
+  bool decodeArithmetic(const uint8_t *data, size_t size, uint8_t *out,
+                        size_t originalSize) const {
+    ArithmeticDecoder decoder(data, size);
+    for (size_t i = 0; i < originalSize; i++) {
+      int symbol = arithmeticModel.find(decoder.target_pow2(MODEL_TOTAL_BITS));
+      if (symbol >= BYTE_SYMBOLS)
+        return false;
+      decoder.consume(arithmeticModel.cum_low(symbol),
+                      arithmeticModel.cum_high(symbol), MODEL_TOTAL);
+      out[i] = (uint8_t)symbol;
+    }
+    return true;
+  }
+
+  void encodeLZ(const uint8_t *data, size_t size,
+                std::vector<uint8_t> &out) const {
+    BitWriter writer(out);
+    parseLZ(data, size,
+            [&](size_t literalStart, size_t run, size_t length,
+                size_t offset) {
+              uint32_t field = sharedMatchField(length);
+              int runBucket = sharedFieldBucket((uint32_t)run);
+              int fieldBucket = sharedFieldBucket(field);
+              writeSymbol(writer, commandCode, runBucket << 4 | fieldBucket);
+              writeField(writer, (uint32_t)run, runBucket);
+              for (size_t i = 0; i < run; i++)
+                writeSymbol(writer, literalCode, data[literalStart + i]);
+              if (field == 0)
+                return;
+              writeField(writer, field, fieldBucket);
+              int offsetBucket = sharedOffsetBucket(offset);
+              writeSymbol(writer, offsetCode, offsetBucket);
+              writer.writeBits(offset, offsetBucket - 1);
+            });
+    writer.flush();
+  }
+
+  bool decodeLZ(const uint8_t *data, size_t size, uint8_t *out,
+                size_t originalSize) const {
+    BitReader reader(data, size);
+    size_t pos = 0;
+    while (pos < originalSize) {
+      if (reader.position() > (uint64_t)size * 8)
+        return false;
+      int command = readSymbol(reader, commandCode);
+      int fieldBucket = command & 15;
+      size_t run = readField(reader, command >> 4);
+      if (run == 0 && fieldBucket == 0)
+        return false; // 合法的码流中每个记号至少输出一个字节
+      if (run > originalSize - pos)
+        return false;
+      for (size_t i = 0; i < run; i++)
+        out[pos++] = (uint8_t)readSymbol(reader, literalCode);
+      if (fieldBucket == 0)
+        continue;
+      size_t length = readField(reader, fieldBucket) + LZ77_MIN_MATCH - 1;
+      int offsetBucket = readSymbol(reader, offsetCode);
+      if (offsetBucket == 0 || offsetBucket >= SHARED_OFFSET_BUCKETS)
+        return false;
+      size_t offset = ((size_t)1 << (offsetBucket - 1)) |
+                      reader.readBits(offsetBucket - 1);
+      if (length > originalSize - pos || offset > pos + dictionarySize)
+        return false;
+      // 前面的部分可能落在字典末尾，逐字节复制也处理了重叠
+      for (size_t i = 0; i < length; i++, pos++) {
+        out[pos] = offset > pos ? dictionary[dictionarySize + pos - offset]
+                                : out[pos - offset];
+      }
+    }
+    return true;
+  }
+
+  void *mapped = nullptr;
+  size_t mappedSize = 0;
+  uint32_t modelId = 0;
+  const uint8_t *dictionary = nullptr; // 指向模型文件中的字典
+  size_t dictionarySize = 0;
+  std::vector<uint32_t> dictionaryHead; // 哈希 -> 最近位置+1
+  std::vector<uint32_t> dictionaryPrev; // 位置 -> 同哈希的上一个位置+1
+  SharedCode byteCode, literalCode, commandCode, offsetCode;
+  StaticFrequencyModel arithmeticModel;
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BlockFrame.h"
+
+// 流式分块格式（小端序）：
+//   4字节块大小 | 若干个块：4字节原始大小 | 4字节压缩后大小 | 压缩数据
+// 原始大小为0的块表示流结束，除最后一个数据块外每块都恰好为块大小。
+// 与BlockFrame.h不同，流头不记录总长度，块在输入凑满时就压缩输出，
+// 压缩端最多缓存一块原始数据，解压端最多缓存一块压缩数据，
+// 内存占用只取决于块大小，与输入总长度无关，可以处理管道等长度未知的输入
+
+// 一块压缩后允许的最大大小，超过时认为数据损坏。
+// 最坏情况（LZ78遇到随机数据）每字节约3.5字节，留出余量
+inline size_t maxCompressedBlockSize(size_t blockSize) {
+  return blockSize * 4 + 65536;
+}
+
+// 块索引项：块在原始数据中的起点，块头在流中的位置（从流头算起）
+struct StreamIndexEntry {
+  uint64_t originalOffset;
+  uint64_t streamOffset;
+};
+
+class StreamCompressor {
+public:
+  explicit StreamCompressor(const BlockEncoder &encodeBlock,
+                            size_t blockSize = DEFAULT_BLOCK_SIZE)
+      : encodeBlock(encodeBlock), blockSize(blockSize) {
+    pending.reserve(blockSize);
+  }
+
+  // 输入一段数据，把凑满的块压缩后追加到out。没有缓存的数据时整块直接从data压缩，
+  // 输入来自mmap时不需要先复制到缓冲区
+  void update(const char *data, size_t size, std::vector<uint8_t> &out) {
+    writeHeader(out);
+    if (!pending.empty()) {
+      size_t n = std::min(size, blockSize - pending.size());
+      pending.insert(pending.end(), data, data + n);
+      data += n;
+      size -= n;
+      if (pending.size() < blockSize)
+        return;
+      emitBlock(pending.data(), pending.size(), out);
+      pending.clear();
+    }
+    for (; size >= blockSize; data += blockSize, size -= blockSize)
+      emitBlock(data, blockSize, out);
+    pending.insert(pending.end(), data, data + size);
+  }
+
+  // 压缩剩余的数据并写出结束标记
+  void finish(std::vector<uint8_t> &out) {
+    writeHeader(out);
+    if (!pending.empty())
+      emitBlock(pending.data(), pending.size(), out);
+    pending.clear();
+    blockIndex.push_back({originalBytes, streamBytes});
+    size_t start = out.size();
+    out.resize(start + 8, 0);
+    streamBytes += 8;
+  }
+
+  // 已写出的每块的索引，finish之后最后一项为原始总长度和结束标记的位置
+  const std::vector<StreamIndexEntry> &index() const { return blockIndex; }
+
+private:
+  void writeHeader(std::vector<uint8_t> &out) {
+    if (headerWritten)
+      return;
+    headerWritten = true;
+    size_t start = out.size();
+    out.resize(start + 4);
+    putLE32(out, start, (uint32_t)blockSize);
+    streamBytes += 4;
+  }
+
+  void emitBlock(const char *data, size_t size, std::vector<uint8_t> &out) {
+    payload.clear();
+    encodeBlock(data, size, payload);
+    blockIndex.push_back({originalBytes, streamBytes});
+    size_t start = out.size();
+    out.resize(start + 8);
+    putLE32(out, start, (uint32_t)size);
+    putLE32(out, start + 4, (uint32_t)payload.size());
+    out.insert(out.end(), payload.begin(), payload.end());
+    originalBytes += size;
+    streamBytes += 8 + payload.size();
+  }
+
+  BlockEncoder encodeBlock;
+  size_t blockSize;
+  bool headerWritten = false;
+  std::vector<char> pending;    // 未凑满一块的原始数据
+  std::vector<uint8_t> payload; // 当前块的压缩结果，各块共用
+  uint64_t originalBytes = 0;   // 已压缩的原始字节数
+  uint64_t streamBytes = 0;     // 已写出的流字节数
+  std::vector<StreamIndexEntry> blockIndex;
+};
+
+class StreamDecompressor {
+public:
+  // maxBlockSize限制流头中的块大小，防止损坏的数据申请过多内存
+  explicit StreamDecompressor(const BlockDecoder &decodeBlock,
+                              size_t maxBlockSize = (size_t)64 << 20)
+      : decodeBlock(decodeBlock), maxBlockSize(maxBlockSize) {}
+
+  // 输入一段压缩数据，把解出的块追加到out；格式错误时返回false。
+  // 一块压缩数据完整地位于data中时直接解压，不经过缓冲区
+  bool update(const uint8_t *data, size_t size, std::string &out) {
+    // 从data中补齐buffer到want字节，补齐时返回true
+    auto fill = [&](size_t want) {
+      size_t n = std::min(size, want - buffer.size());
+      buffer.insert(buffer.end(), data, data + n);
+      data += n;
+      size -= n;
+      return buffer.size() == want;
+    };
+
+    while (!finished) {
+      if (blockSize == 0) {
+        if (!fill(4))
+          return true;
+        blockSize = getLE32(buffer.data());
+        buffer.clear();
+        if (blockSize == 0 || blockSize > maxBlockSize)
+          return false;
+        continue;
+      }
+      if (!inBlock) {
+        if (!fill(8))
+          return true;
+        originalSize = getLE32(buffer.data());
+        compressedSize = getLE32(buffer.data() + 4);
+        buffer.clear();
+        if (originalSize == 0) {
+          finished = true;
+          return compressedSize == 0;
+        }
+        if (originalSize > blockSize ||
+            compressedSize > maxCompressedBlockSize(blockSize))
+          return false;
+        inBlock = true;
+        continue;
+      }
+
+      const uint8_t *payload;
+      if (buffer.empty() && size >= compressedSize) {
+        payload = data;
+        data += compressedSize;
+        size -= compressedSize;
+      } else {
+        if (!fill(compressedSize))
+          return true;
+        payload = buffer.data();
+      }
+      size_t begin = out.size();
+      out.resize(begin + originalSize);
+      if (!decodeBlock(payload, compressedSize, &out[begin], originalSize))
+        return false;
+      buffer.clear();
+      inBlock = false;
+    }
+    return true;
+  }
+
+  // 是否已经读到结束标记
+  bool done() const { return finished; }
+
+private:
+  BlockDecoder decodeBlock;
+  size_t maxBlockSize;
+  size_t blockSize = 0; // 0表示还没有读到流头
+  bool inBlock = false; // 已读出块头，正在等待压缩数据
+  uint32_t originalSize = 0;
+  uint32_t compressedSize = 0;
+  bool finished = false;
+  std::vector<uint8_t> buffer; // 未凑齐的流头、块头或压缩数据
+};
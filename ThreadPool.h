@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定线程数的线程池。parallelFor把[0, count)的任务分给所有线程（含调用线程），
+// 任务按下标依次领取，返回时全部完成
+class ThreadPool {
+public:
+  explicit ThreadPool(int threads) {
+    for (int i = 1; i < threads; i++)
+      workers.emplace_back([this] { workerLoop(); });
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+      worker.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  int size() const { return (int)workers.size() + 1; }
+
+  void parallelFor(size_t count, const std::function<void(size_t)> &fn) {
+    if (count == 0)
+      return;
+    {
+      // 先等上一轮醒得晚的线程退出，再发布新一轮任务
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [&] { return active == 0; });
+      task = &fn;
+      taskCount = count;
+      next = 0;
+      generation++;
+    }
+    wake.notify_all();
+    runTasks(&fn, count);
+
+    // 所有下标都已被领取；领取过任务的线程都计入了active
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return active == 0; });
+  }
+
+  // 默认线程数：硬件线程数，无法获取时为1
+  static int defaultThreads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : (int)n;
+  }
+
+private:
+  void runTasks(const std::function<void(size_t)> *fn, size_t count) {
+    for (size_t i = next++; i < count; i = next++)
+      (*fn)(i);
+  }
+
+  void workerLoop() {
+    size_t seen = 0;
+    while (true) {
+      const std::function<void(size_t)> *fn;
+      size_t count;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping)
+          return;
+        seen = generation;
+        fn = task;
+        count = taskCount;
+        active++;
+      }
+      runTasks(fn, count);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        active--;
+      }
+      done.notify_all();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake; // 通知工作线程有新一轮任务
+  std::condition_variable done; // 通知调用线程有工作线程退出本轮
+  const std::function<void(size_t)> *task = nullptr;
+  size_t taskCount = 0;
+  std::atomic<size_t> next{0}; // 下一个待领取的任务下标
+  size_t generation = 0;       // 任务轮次
+  int active = 0;              // 正在执行本轮任务的工作线程数
+  bool stopping = false;
+};
@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "Codecs.h"
+#include "SharedModel.h"
+
+using namespace std;
+
+// 从样本语料训练小消息的共享模型（格式见SharedModel.h），写出模型文件，
+// 再用映射加载的模型在留出的记录上与逐条独立压缩比较压缩率和延迟
+
+const size_t DEFAULT_DICTIONARY_SIZE = (size_t)16 << 10;
+const int DMER_SIZE = 8; // 字典训练按8字节的片段计分
+const int DMER_HASH_BITS = 20;
+const size_t SEGMENT_SIZE = 64; // 候选片段长度
+const int HOLDOUT_EVERY = 5;    // 每5条记录留出1条用于评估
+
+// 每行一条记录，忽略空行
+vector<string> readRecords(const string &path) {
+  ifstream file(path, ios::binary);
+  vector<string> records;
+  string line;
+  while (getline(file, line)) {
+    if (!line.empty())
+      records.push_back(line + "\n");
+  }
+  return records;
+}
+
+uint32_t dmerHash(const string &s, size_t pos) {
+  uint64_t word;
+  memcpy(&word, s.data() + pos, 8);
+  return (uint32_t)((word * 0x9E3779B97F4A7C15ULL) >> (64 - DMER_HASH_BITS));
+}
+
+struct Segment {
+  int record;
+  size_t start, length;
+};
+
+// 选字典片段：每个8字节片段的得分为出现它的记录数 - 1，候选片段的得分为其中
+// 尚未被已选片段覆盖的8字节片段得分之和。贪心地每次选得分最高的候选：
+// 选中后得分只会下降，所以从堆中取出后重新计分，仍不低于堆顶时才选用。
+// 先选的片段放在字典末尾，离消息最近，偏移最短
+string buildDictionary(const vector<string> &records, size_t dictionarySize) {
+  vector<uint32_t> counts((size_t)1 << DMER_HASH_BITS, 0);
+  vector<int> lastRecord((size_t)1 << DMER_HASH_BITS, -1);
+  for (size_t r = 0; r < records.size(); r++) {
+    const string &s = records[r];
+    for (size_t i = 0; i + DMER_SIZE <= s.size(); i++) {
+      uint32_t h = dmerHash(s, i);
+      if (lastRecord[h] != (int)r) {
+        lastRecord[h] = (int)r;
+        counts[h]++;
+      }
+    }
+  }
+
+  vector<Segment> segments;
+  for (size_t r = 0; r < records.size(); r++) {
+    size_t size = records[r].size();
+    for (size_t start = 0; start + DMER_SIZE <= size;
+         start += SEGMENT_SIZE / 2) {
+      segments.push_back({(int)r, start, min(SEGMENT_SIZE, size - start)});
+    }
+  }
+  vector<bool> covered((size_t)1 << DMER_HASH_BITS, false);
+  auto score = [&](const Segment &segment) {
+    const string &s = records[segment.record];
+    uint64_t total = 0;
+    for (size_t i = segment.start;
+         i + DMER_SIZE <= segment.start + segment.length; i++) {
+      uint32_t h = dmerHash(s, i);
+      if (!covered[h])
+        total += counts[h] - 1;
+    }
+    return total;
+  };
+
+  priority_queue<pair<uint64_t, size_t>> heap;
+  for (size_t i = 0; i < segments.size(); i++)
+    heap.push({score(segments[i]), i});
+  vector<size_t> chosen;
+  size_t used = 0;
+  while (!heap.empty() && used < dictionarySize) {
+    pair<uint64_t, size_t> top = heap.top();
+    heap.pop();
+    uint64_t current = score(segments[top.second]);
+    if (!heap.empty() && current < heap.top().first) {
+      heap.push({current, top.second});
+      continue;
+    }
+    if (current == 0)
+      break; // 其余候选的得分都不会更高
+    const Segment &segment = segments[top.second];
+    for (size_t i = segment.start;
+         i + DMER_SIZE <= segment.start + segment.length; i++)
+      covered[dmerHash(records[segment.record], i)] = true;
+    chosen.push_back(top.second);
+    used += segment.length;
+  }
+
+  string dictionary;
+  for (size_t k = chosen.size(); k-- > 0;) {
+    const Segment &segment = segments[chosen[k]];
+    dictionary += records[segment.record].substr(segment.start, segment.length);
+  }
+  if (dictionary.size() > dictionarySize)
+    dictionary.erase(0, dictionary.size() - dictionarySize);
+  return dictionary;
+}
+
+// 所有可能出现的符号频率至少为1，保证任何消息都能编码
+vector<int> smoothedCodeLengths(vector<uint64_t> freqs, int count) {
+  for (int s = 0; s < count; s++)
+    freqs[s]++;
+  return buildCodeLengths(freqs);
+}
+
+// 训练出的码表写入tables；占位码长的草稿模型不能解析时返回false
+bool train(const vector<string> &records, size_t dictionarySize,
+           uint32_t modelId, SharedModelTables &tables) {
+  tables.dictionary = buildDictionary(records, dictionarySize);
+  tables.byteFreqs.assign(BYTE_SYMBOLS, 0);
+  for (const string &record : records)
+    countByteFrequencies((const uint8_t *)record.data(), record.size(),
+                         tables.byteFreqs.data());
+  for (uint64_t &freq : tables.byteFreqs)
+    freq++;
+  tables.byteLengths = buildCodeLengths(tables.byteFreqs);
+
+  // LZ记号的统计需要按最终的字典分段：先用占位的码长生成模型
+  tables.literalLengths.assign(BYTE_SYMBOLS, 8);
+  tables.commandLengths.assign(BYTE_SYMBOLS, 8);
+  tables.offsetLengths = smoothedCodeLengths(
+      vector<uint64_t>(BYTE_SYMBOLS, 0), SHARED_OFFSET_BUCKETS);
+  vector<uint8_t> draft;
+  writeSharedModel(tables, draft);
+  SharedModel model;
+  if (!model.parse(draft.data(), draft.size()))
+    return false;
+
+  vector<uint64_t> literalFreqs(BYTE_SYMBOLS, 0);
+  vector<uint64_t> commandFreqs(BYTE_SYMBOLS, 0);
+  vector<uint64_t> offsetFreqs(BYTE_SYMBOLS, 0);
+  for (const string &record : records) {
+    const uint8_t *data = (const uint8_t *)record.data();
+    model.parseLZ(data, record.size(),
+                  [&](size_t literalStart, size_t run, size_t length,
+                      size_t offset) {
+                    uint32_t field = sharedMatchField(length);
+                    commandFreqs[sharedFieldBucket(run) << 4 |
+                                 sharedFieldBucket(field)]++;
+                    for (size_t i = 0; i < run; i++)
+                      literalFreqs[data[literalStart + i]]++;
+                    if (field > 0)
+                      offsetFreqs[sharedOffsetBucket(offset)]++;
+                  });
+  }
+  tables.literalLengths = smoothedCodeLengths(literalFreqs, BYTE_SYMBOLS);
+  tables.commandLengths = smoothedCodeLengths(commandFreqs, BYTE_SYMBOLS);
+  tables.offsetLengths =
+      smoothedCodeLengths(offsetFreqs, SHARED_OFFSET_BUCKETS);
+
+  // 未指定编号时取模型内容（编号为0时）的CRC32C
+  tables.modelId = 0;
+  if (modelId == 0) {
+    vector<uint8_t> content;
+    writeSharedModel(tables, content);
+    modelId = crc32c(content.data(), content.size() - 4); // 不含末尾的CRC
+  }
+  tables.modelId = modelId;
+  return true;
+}
+
+// 对所有留出的记录重复压缩或解压，直到累计至少0.2秒，返回每条消息的微秒数
+template <typename Run> double microsPerMessage(size_t messages, Run run) {
+  auto start = chrono::steady_clock::now();
+  size_t rounds = 0;
+  double seconds;
+  do {
+    run();
+    rounds++;
+    seconds =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  } while (seconds < 0.2);
+  return seconds * 1e6 / (rounds * messages);
+}
+
+void printRow(const string &name, size_t compressed, size_t original,
+              double encodeMicros, double decodeMicros) {
+  cout << left << setw(16) << name << right << setw(10) << compressed
+       << setw(8) << fixed << setprecision(3) << (double)compressed / original
+       << setw(10) << setprecision(2) << encodeMicros << setw(10)
+       << decodeMicros << endl;
+}
+
+// 共享模型的各方法和逐条独立压缩的分块编码器，在留出的记录上比较。
+// 解压结果与原文不同时返回false
+bool evaluate(const SharedModel &model, const vector<string> &records) {
+  size_t original = 0, longest = 0;
+  for (const string &record : records) {
+    original += record.size();
+    longest = max(longest, record.size());
+  }
+  cout << records.size() << " held-out records, " << original << " bytes"
+       << endl;
+  cout << left << setw(16) << "method" << right << setw(10) << "bytes"
+       << setw(8) << "ratio" << setw(10) << "enc us" << setw(10) << "dec us"
+       << endl;
+
+  vector<uint8_t> out;
+  vector<char> decoded(longest);
+  const char *methodNames[SHARED_METHODS] = {"shared-stored", "shared-huffman",
+                                             "shared-arith", "shared-lz"};
+  for (int method = 0; method < SHARED_METHODS; method++) {
+    vector<vector<uint8_t>> frames(records.size());
+    size_t compressed = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+      model.compress(records[i].data(), records[i].size(), frames[i], method);
+      compressed += frames[i].size();
+      size_t size;
+      if (!model.decompress(frames[i].data(), frames[i].size(), decoded.data(),
+                            decoded.size(), size) ||
+          string(decoded.data(), size) != records[i]) {
+        cout << methodNames[method] << ": FAILED on record " << i << endl;
+        return false;
+      }
+    }
+    double encodeMicros = microsPerMessage(records.size(), [&]() {
+      for (const string &record : records) {
+        out.clear();
+        model.compress(record.data(), record.size(), out, method);
+      }
+    });
+    double decodeMicros = microsPerMessage(records.size(), [&]() {
+      size_t size;
+      for (const vector<uint8_t> &frame : frames)
+        model.decompress(frame.data(), frame.size(), decoded.data(),
+                         decoded.size(), size);
+    });
+    printRow(methodNames[method], compressed, original, encodeMicros,
+             decodeMicros);
+  }
+
+  // 分块编码器逐条压缩时需要自带模型
+  for (const char *name : {"huffman", "rans", "lz77", "lz78-huffman", "auto"}) {
+    const Codec &codec = codecs()[findCodec(name)];
+    vector<vector<uint8_t>> blocks(records.size());
+    size_t compressed = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+      codec.encodeBlock(records[i].data(), records[i].size(), blocks[i]);
+      compressed += blocks[i].size();
+    }
+    double encodeMicros = microsPerMessage(records.size(), [&]() {
+      for (const string &record : records) {
+        out.clear();
+        codec.encodeBlock(record.data(), record.size(), out);
+      }
+    });
+    double decodeMicros = microsPerMessage(records.size(), [&]() {
+      for (size_t i = 0; i < records.size(); i++)
+        codec.decodeBlock(blocks[i].data(), blocks[i].size(), decoded.data(),
+                          records[i].size());
+    });
+    printRow(name, compressed, original, encodeMicros, decodeMicros);
+  }
+  return true;
+}
+
+void printUsage(const char *program) {
+  cerr << "Usage: " << program
+       << " [-d dictionary KiB] [-i model id] sample model" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  // 用法: Train.o [-d 字典大小KiB] [-i 模型编号] 样本 模型文件，
+  // 样本每行一条记录
+  size_t dictionarySize = DEFAULT_DICTIONARY_SIZE;
+  uint32_t modelId = 0;
+  vector<string> paths;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "-d" && i + 1 < argc) {
+      dictionarySize = (size_t)strtoull(argv[++i], nullptr, 10) << 10;
+      if (dictionarySize > SHARED_MAX_DICTIONARY) {
+        cerr << "Dictionary size must be at most "
+             << (SHARED_MAX_DICTIONARY >> 10) << " KiB" << endl;
+        return 1;
+      }
+    } else if (arg == "-i" && i + 1 < argc) {
+      modelId = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      printUsage(argv[0]);
+      return 1;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  vector<string> records = readRecords(paths[0]);
+  if (records.empty()) {
+    cerr << "No records in " << paths[0] << endl;
+    return 1;
+  }
+  // 记录足够多时留出一部分，评估的是没见过的消息
+  vector<string> training, heldOut;
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records.size() >= HOLDOUT_EVERY && i % HOLDOUT_EVERY == 0)
+      heldOut.push_back(records[i]);
+    else
+      training.push_back(records[i]);
+  }
+  if (heldOut.empty())
+    heldOut = training;
+
+  SharedModelTables tables;
+  if (!train(training, dictionarySize, modelId, tables)) {
+    cerr << "Failed to build the draft model" << endl;
+    return 1;
+  }
+  vector<uint8_t> content;
+  writeSharedModel(tables, content);
+  // 写出之前先确认最终的模型能被解析，自检失败时不留下模型文件
+  SharedModel check;
+  if (!check.parse(content.data(), content.size())) {
+    cerr << "Trained model failed its self-check" << endl;
+    return 1;
+  }
+  ofstream file(paths[1], ios::binary);
+  file.write((const char *)content.data(), content.size());
+  file.close();
+  if (!file) {
+    cerr << "Failed to write " << paths[1] << endl;
+    return 1;
+  }
+  cout << "Trained on " << training.size() << " records, model " << hex
+       << tables.modelId << dec << ", dictionary " << tables.dictionary.size()
+       << " bytes, file " << content.size() << " bytes" << endl;
+
+  SharedModel model;
+  if (!model.load(paths[1].c_str())) {
+    cerr << "Failed to load " << paths[1] << endl;
+    return 1;
+  }
+  return evaluate(model, heldOut) ? 0 : 1;
+}